@@ -0,0 +1,210 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__BIT_VECTOR_HPP_
+#define SUPER_VECTOR__BIT_VECTOR_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include "vector.hpp"
+#include "vector_simd.hpp"
+
+// Packed bits over vector<uint64_t>, so copies share the words through COW. Bits past
+// size() in the last word are kept zero. rank and select use an index of cumulative
+// counts per 512 bits, built on the first query after a change; the index is mutable
+// state, so concurrent const queries need external synchronization like writes do.
+class bit_vector {
+  public:
+  bit_vector() = default;
+
+  explicit bit_vector(size_t n, bool value = false) {
+      size_t count = words_for_(n);
+      words_.reserve(count);
+      for (size_t i = 0; i != count; ++i) {
+          words_.push_back(value ? ~uint64_t(0) : 0);
+      }
+      size_ = n;
+      clear_tail_();
+  }
+
+  size_t size() const noexcept {
+      return size_;
+  }
+
+  bool empty() const noexcept {
+      return size_ == 0;
+  }
+
+  vector<uint64_t> const &words() const noexcept {
+      return words_;
+  }
+
+  bool operator[](size_t i) const noexcept {
+      return std::as_const(words_)[i / 64] >> (i % 64) & 1;
+  }
+
+  void set(size_t i, bool value = true) {
+      uint64_t &word = words_[i / 64];
+      uint64_t bit = uint64_t(1) << (i % 64);
+      word = value ? word | bit : word & ~bit;
+      indexed_ = false;
+  }
+
+  void reset(size_t i) {
+      set(i, false);
+  }
+
+  void flip(size_t i) {
+      words_[i / 64] ^= uint64_t(1) << (i % 64);
+      indexed_ = false;
+  }
+
+  // strong
+  void push_back(bool value) {
+      if (size_ % 64 == 0) {
+          words_.push_back(0);
+      }
+      if (value) {
+          words_[size_ / 64] |= uint64_t(1) << (size_ % 64);
+      }
+      ++size_;
+      indexed_ = false;
+  }
+
+  void clear() {
+      words_.clear();
+      size_ = 0;
+      indexed_ = false;
+  }
+
+  // number of set bits
+  size_t count() const noexcept {
+      return vector_simd::popcount(words_.data(), words_.size());
+  }
+
+  // number of set bits in [0, i), i <= size()
+  size_t rank(size_t i) const {
+      build_index_();
+      uint64_t const *w = words_.data();
+      size_t block = i / BLOCK_BITS_;
+      size_t result = std::as_const(ranks_)[block];
+      for (size_t k = block * BLOCK_WORDS_; k != i / 64; ++k) {
+          result += __builtin_popcountll(w[k]);
+      }
+      if (i % 64 != 0) {
+          result += __builtin_popcountll(w[i / 64] & ((uint64_t(1) << (i % 64)) - 1));
+      }
+      return result;
+  }
+
+  // position of the set bit with rank k, size() if there are not that many
+  size_t select(size_t k) const {
+      build_index_();
+      uint64_t const *r = ranks_.data();
+      size_t blocks = ranks_.size();
+      if (k >= r[blocks - 1]) {
+          return size_;
+      }
+      size_t block = std::upper_bound(r, r + blocks, k) - r - 1;
+      k -= r[block];
+      uint64_t const *w = words_.data();
+      size_t word = block * BLOCK_WORDS_;
+      for (size_t ones; k >= (ones = __builtin_popcountll(w[word])); ++word) {
+          k -= ones;
+      }
+      uint64_t bits = w[word];
+      for (; k != 0; --k) {
+          bits &= bits - 1;
+      }
+      return word * 64 + __builtin_ctzll(bits);
+  }
+
+  // bulk operations need equal sizes, they detach the words of this only
+  bit_vector &operator&=(bit_vector const &other) {
+      return combine_(other, [](uint64_t a, uint64_t b) { return a & b; });
+  }
+
+  bit_vector &operator|=(bit_vector const &other) {
+      return combine_(other, [](uint64_t a, uint64_t b) { return a | b; });
+  }
+
+  bit_vector &operator^=(bit_vector const &other) {
+      return combine_(other, [](uint64_t a, uint64_t b) { return a ^ b; });
+  }
+
+  // clears the bits set in other
+  bit_vector &and_not(bit_vector const &other) {
+      return combine_(other, [](uint64_t a, uint64_t b) { return a & ~b; });
+  }
+
+  friend bool operator==(bit_vector const &a, bit_vector const &b) {
+      return a.size_ == b.size_ && a.words_ == b.words_;
+  }
+
+  friend bool operator!=(bit_vector const &a, bit_vector const &b) {
+      return !(a == b);
+  }
+
+  private:
+  static constexpr size_t BLOCK_WORDS_ = 8;
+  static constexpr size_t BLOCK_BITS_ = BLOCK_WORDS_ * 64;
+
+  vector<uint64_t> words_;
+  size_t size_ = 0;
+  // ranks_[b] is the number of set bits before block b, one extra entry holds the total
+  mutable vector<uint64_t> ranks_;
+  mutable bool indexed_ = false;
+
+  static size_t words_for_(size_t bits) noexcept {
+      return (bits + 63) / 64;
+  }
+
+  void clear_tail_() {
+      if (size_ % 64 != 0) {
+          words_[size_ / 64] &= (uint64_t(1) << (size_ % 64)) - 1;
+      }
+  }
+
+  void build_index_() const {
+      if (indexed_) {
+          return;
+      }
+      size_t n = words_.size();
+      size_t blocks = n / BLOCK_WORDS_ + 1;
+      vector<uint64_t> ranks;
+      ranks.reserve(blocks + 1);
+      uint64_t const *w = words_.data();
+      uint64_t total = 0;
+      for (size_t b = 0; b != blocks; ++b) {
+          ranks.push_back(total);
+          size_t first = b * BLOCK_WORDS_;
+          total += vector_simd::popcount(w + first, std::min(BLOCK_WORDS_, n - first));
+      }
+      ranks.push_back(total);
+      ranks_.swap(ranks);
+      indexed_ = true;
+  }
+
+  template<typename Op>
+  bit_vector &combine_(bit_vector const &other, Op op) {
+      if (size_ != other.size_) {
+          throw std::runtime_error("size mismatch");
+      }
+      if (size_ == 0) {
+          return *this;
+      }
+      // detach first, other keeps the old block if the words were shared
+      uint64_t *dst = words_.data();
+      uint64_t const *src = other.words_.data();
+      for (size_t i = 0, n = words_.size(); i != n; ++i) {
+          dst[i] = op(dst[i], src[i]);
+      }
+      indexed_ = false;
+      return *this;
+  }
+};
+
+#endif //SUPER_VECTOR__BIT_VECTOR_HPP_
@@ -0,0 +1,125 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__CHECKPOINT_HPP_
+#define SUPER_VECTOR__CHECKPOINT_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include "paged_vector.hpp"
+#include "serialization.hpp"
+#include "vector.hpp"
+#include "vector_format.hpp"
+
+// Background checkpoint of a vector or a paged_vector. The constructor takes an O(1)
+// snapshot on the owner's thread and a worker thread streams it to a file in the format
+// of serialization.hpp while the owner keeps writing to the vector: the first write
+// detaches the owner (a paged_vector detaches only the touched page), the worker
+// never waits for it. The snapshot is released on the owner's thread in wait() or the
+// destructor, since the reference counters are not atomic by default.
+namespace checkpoint_detail {
+
+template<typename T>
+void write(vector<T> const &v, int fd) {
+    serialize(v, fd);
+}
+
+template<typename T, size_t PAGE_BYTES>
+void write(paged_vector<T, PAGE_BYTES> const &v, int fd) {
+    static_assert(std::is_trivially_copyable<T>::value, "trivially copyable elements expected");
+    vector_format::file_header h = vector_format::make_header(sizeof(T), v.size());
+    serialization_detail::write_fd(fd, &h, sizeof(h));
+    for (size_t p = 0; p != v.page_count(); ++p) {
+        size_t fill = std::min(v.page_size(), v.size() - p * v.page_size());
+        serialization_detail::write_fd(fd, v.page_data(p), fill * sizeof(T));
+    }
+}
+
+// written to path.tmp and renamed, so a crash leaves the previous checkpoint intact
+template<typename C>
+void write_file(C const &v, std::string const &path) {
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), tmp);
+    }
+    try {
+        write(v, fd);
+        if (::fsync(fd) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fsync");
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    if (::close(fd) != 0 || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        int err = errno;
+        ::unlink(tmp.c_str());
+        throw std::system_error(err, std::generic_category(), path);
+    }
+}
+
+} // namespace checkpoint_detail
+
+template<typename C>
+class checkpoint {
+  public:
+  // takes the snapshot and starts writing it to path
+  checkpoint(C const &v, std::string path) : snapshot_(v.snapshot()), path_(std::move(path)) {
+      thread_ = std::thread([this] {
+          try {
+              checkpoint_detail::write_file(std::as_const(snapshot_), path_);
+          } catch (...) {
+              error_ = std::current_exception();
+          }
+          done_.store(true, std::memory_order_release);
+      });
+  }
+
+  checkpoint(checkpoint const &) = delete;
+  checkpoint &operator=(checkpoint const &) = delete;
+
+  // waits for the worker, an error is lost, call wait() to see it
+  ~checkpoint() {
+      if (thread_.joinable()) {
+          thread_.join();
+      }
+  }
+
+  // the file is complete or the write failed, wait() does not block
+  bool done() const noexcept {
+      return done_.load(std::memory_order_acquire);
+  }
+
+  // blocks until the file is written, rethrows the worker's error
+  void wait() {
+      if (thread_.joinable()) {
+          thread_.join();
+      }
+      snapshot_ = C();
+      if (error_) {
+          std::rethrow_exception(std::exchange(error_, nullptr));
+      }
+  }
+
+  private:
+  C snapshot_;
+  std::string path_;
+  std::exception_ptr error_;
+  std::atomic<bool> done_{false};
+  std::thread thread_;
+};
+
+#endif //SUPER_VECTOR__CHECKPOINT_HPP_
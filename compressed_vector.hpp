@@ -0,0 +1,261 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__COMPRESSED_VECTOR_HPP_
+#define SUPER_VECTOR__COMPRESSED_VECTOR_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "vector.hpp"
+
+// Integer vector compressed in blocks of 128 values. A block stores a reference value
+// and 128 fixed-width fields: value - min with frame_of_reference, value - previous
+// with delta (sorted ids and timestamps). The width is the bit length of the largest
+// field, so a block takes 2 * width words. Values that do not fill a block yet stay
+// uncompressed until it is full. Every part is a vector, so copies share them.
+enum class compression {
+  frame_of_reference,
+  delta
+};
+
+namespace compressed_detail {
+
+constexpr size_t BLOCK_ = 128;
+
+// value j of the block is bits [j * B, j * B + B) of w; B is a constant, so the shifts
+// and masks fold and the loop vectorizes
+template<unsigned B>
+void unpack(uint64_t const *w, uint64_t *out) noexcept {
+    if constexpr (B == 0) {
+        for (size_t j = 0; j != BLOCK_; ++j) {
+            out[j] = 0;
+        }
+    } else {
+        constexpr uint64_t mask = B == 64 ? ~uint64_t(0) : (uint64_t(1) << B) - 1;
+        for (size_t j = 0; j != BLOCK_; ++j) {
+            size_t bit = j * B;
+            size_t word = bit / 64;
+            unsigned shift = bit % 64;
+            uint64_t v = w[word] >> shift;
+            if (shift + B > 64) {
+                v |= w[word + 1] << (64 - shift);
+            }
+            out[j] = v & mask;
+        }
+    }
+}
+
+typedef void (*unpack_fn)(uint64_t const *, uint64_t *);
+
+template<size_t... B>
+constexpr auto make_unpackers(std::index_sequence<B...>) {
+    return std::array<unpack_fn, sizeof...(B)>{{&unpack<B>...}};
+}
+
+inline unpack_fn unpacker(unsigned width) noexcept {
+    static constexpr auto table = make_unpackers(std::make_index_sequence<65>());
+    return table[width];
+}
+
+inline uint64_t extract(uint64_t const *w, unsigned width, size_t j) noexcept {
+    if (width == 0) {
+        return 0;
+    }
+    size_t bit = j * width;
+    unsigned shift = bit % 64;
+    uint64_t v = w[bit / 64] >> shift;
+    if (shift + width > 64) {
+        v |= w[bit / 64 + 1] << (64 - shift);
+    }
+    return width == 64 ? v : v & ((uint64_t(1) << width) - 1);
+}
+
+} // namespace compressed_detail
+
+template<typename T, compression Mode = compression::frame_of_reference>
+class compressed_vector {
+  static_assert(std::is_same<T, uint32_t>::value || std::is_same<T, uint64_t>::value,
+                "uint32_t or uint64_t expected");
+  static constexpr size_t BLOCK_ = compressed_detail::BLOCK_;
+
+  public:
+  compressed_vector() = default;
+
+  // strong
+  explicit compressed_vector(vector<T> const &v) {
+      T const *p = v.data();
+      size_t n = v.size();
+      size_t i = 0;
+      for (; i + BLOCK_ <= n; i += BLOCK_) {
+          encode_(p + i);
+      }
+      for (; i != n; ++i) {
+          tail_.push_back(p[i]);
+      }
+  }
+
+  size_t size() const noexcept {
+      return offsets_.size() * BLOCK_ + tail_.size();
+  }
+
+  bool empty() const noexcept {
+      return size() == 0;
+  }
+
+  // strong
+  void push_back(T value) {
+      if (tail_.size() + 1 != BLOCK_) {
+          tail_.push_back(value);
+          return;
+      }
+      T block[BLOCK_];
+      T const *tail = std::as_const(tail_).data();
+      std::copy(tail, tail + tail_.size(), block);
+      block[BLOCK_ - 1] = value;
+      encode_(block);
+      tail_.clear();
+  }
+
+  // O(1) with frame_of_reference, O(128) with delta
+  T operator[](size_t i) const noexcept {
+      size_t block = i / BLOCK_;
+      if (block == offsets_.size()) {
+          return std::as_const(tail_)[i % BLOCK_];
+      }
+      uint64_t const *w = packed_.data() + std::as_const(offsets_)[block];
+      unsigned width = width_(block);
+      T base = std::as_const(bases_)[block];
+      if constexpr (Mode == compression::frame_of_reference) {
+          return static_cast<T>(base + compressed_detail::extract(w, width, i % BLOCK_));
+      } else {
+          T value = base;
+          for (size_t j = 1; j <= i % BLOCK_; ++j) {
+              value += static_cast<T>(compressed_detail::extract(w, width, j));
+          }
+          return value;
+      }
+  }
+
+  // out gets size() elements, its buffer is reused if it is unique and large enough; basic
+  void decompress(vector<T> &out) const {
+      size_t n = size();
+      out.resize_for_overwrite(n);
+      if (n == 0) {
+          return;
+      }
+      T *dst = out.data();
+      uint64_t const *packed = packed_.data();
+      uint64_t const *offsets = offsets_.data();
+      T const *bases = bases_.data();
+      uint64_t fields[BLOCK_];
+      for (size_t block = 0; block != offsets_.size(); ++block) {
+          compressed_detail::unpacker(width_(block))(packed + offsets[block], fields);
+          T *d = dst + block * BLOCK_;
+          T base = bases[block];
+          if constexpr (Mode == compression::frame_of_reference) {
+              for (size_t j = 0; j != BLOCK_; ++j) {
+                  d[j] = static_cast<T>(base + fields[j]);
+              }
+          } else {
+              for (size_t j = 0; j != BLOCK_; ++j) {
+                  base += static_cast<T>(fields[j]);
+                  d[j] = base;
+              }
+          }
+      }
+      T const *tail = tail_.data();
+      std::copy(tail, tail + tail_.size(), dst + offsets_.size() * BLOCK_);
+  }
+
+  vector<T> decompress() const {
+      vector<T> result;
+      decompress(result);
+      return result;
+  }
+
+  // bytes of packed fields, block index and uncompressed tail
+  size_t compressed_bytes() const noexcept {
+      return packed_.size() * sizeof(uint64_t) + offsets_.size() * sizeof(uint64_t)
+          + bases_.size() * sizeof(T) + tail_.size() * sizeof(T);
+  }
+
+  void clear() {
+      packed_.clear();
+      offsets_.clear();
+      bases_.clear();
+      tail_.clear();
+  }
+
+  private:
+  // word offset of every block in packed_, a block's width is half its word count
+  vector<uint64_t> offsets_;
+  vector<T> bases_;
+  vector<uint64_t> packed_;
+  vector<T> tail_;
+
+  unsigned width_(size_t block) const noexcept {
+      size_t end = block + 1 == offsets_.size() ? packed_.size() : std::as_const(offsets_)[block + 1];
+      return static_cast<unsigned>((end - std::as_const(offsets_)[block]) / 2);
+  }
+
+  // strong
+  void encode_(T const *p) {
+      uint64_t fields[BLOCK_];
+      T base;
+      if constexpr (Mode == compression::frame_of_reference) {
+          base = *std::min_element(p, p + BLOCK_);
+          for (size_t j = 0; j != BLOCK_; ++j) {
+              fields[j] = p[j] - base;
+          }
+      } else {
+          base = p[0];
+          fields[0] = 0;
+          for (size_t j = 1; j != BLOCK_; ++j) {
+              fields[j] = static_cast<T>(p[j] - p[j - 1]);
+          }
+      }
+      uint64_t all = 0;
+      for (size_t j = 0; j != BLOCK_; ++j) {
+          all |= fields[j];
+      }
+      unsigned width = all == 0 ? 0 : 64 - __builtin_clzll(all);
+      uint64_t words[2 * 64] = {};
+      for (size_t j = 0; j != BLOCK_ && width != 0; ++j) {
+          size_t bit = j * width;
+          unsigned shift = bit % 64;
+          words[bit / 64] |= fields[j] << shift;
+          if (shift + width > 64) {
+              words[bit / 64 + 1] |= fields[j] >> (64 - shift);
+          }
+      }
+      // pushing the index entries last keeps the old state if an allocation throws
+      size_t old = packed_.size();
+      try {
+          // reserve grows to exactly the size asked for, so double it here
+          if (old + 2 * width > packed_.capacity()) {
+              packed_.reserve(std::max<size_t>(old + 2 * width, 2 * packed_.capacity()));
+          }
+          for (size_t k = 0; k != 2 * width; ++k) {
+              packed_.push_back(words[k]);
+          }
+          bases_.push_back(base);
+          try {
+              offsets_.push_back(old);
+          } catch (...) {
+              bases_.pop_back();
+              throw;
+          }
+      } catch (...) {
+          while (packed_.size() != old) {
+              packed_.pop_back();
+          }
+          throw;
+      }
+  }
+};
+
+#endif //SUPER_VECTOR__COMPRESSED_VECTOR_HPP_
@@ -0,0 +1,147 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__CONCURRENT_VECTOR_HPP_
+#define SUPER_VECTOR__CONCURRENT_VECTOR_HPP_
+
+#include <atomic>
+#include <memory>
+#include <assert.h>
+
+// Append-only vector for many producers and concurrent readers. Elements live in
+// exponentially growing segments which are never moved, so addresses stay valid.
+// push_back reserves a slot with a single fetch_add and publishes it through a
+// per-slot flag; readers must check is_published() before touching a slot.
+template<typename T>
+class concurrent_vector {
+  public:
+  typedef T value_type;
+  typedef T &reference;
+  typedef T const &const_reference;
+  typedef size_t size_type;
+  private:
+  typedef char *mix_ptr;
+  static constexpr size_type FIRST_SEGMENT_BITS_ = 3;
+  static constexpr size_type FIRST_SEGMENT_ = size_type(1) << FIRST_SEGMENT_BITS_;
+  static constexpr size_type SEGMENTS_ = 8 * sizeof(size_type) - FIRST_SEGMENT_BITS_;
+
+  std::atomic<size_type> size_{0};
+  std::atomic<mix_ptr> segments_[SEGMENTS_] = {};
+
+  // _____________________________________________________________________________________________
+  // service function
+
+  // segment k: [publication flags, FIRST_SEGMENT_ << k][data, FIRST_SEGMENT_ << k]
+  static size_type seg_len_(size_type k) noexcept {
+      return FIRST_SEGMENT_ << k;
+  }
+
+  static size_type flags_bytes_(size_type k) noexcept {
+      size_type align = alignof(value_type);
+      return (seg_len_(k) + align - 1) / align * align;
+  }
+
+  static std::atomic<unsigned char> *seg_flags_(mix_ptr seg) noexcept {
+      return reinterpret_cast<std::atomic<unsigned char> *>(seg);
+  }
+
+  static T *seg_data_(mix_ptr seg, size_type k) noexcept {
+      return reinterpret_cast<T *>(seg + flags_bytes_(k));
+  }
+
+  static size_type segment_of_(size_type ind) noexcept {
+      return 8 * sizeof(size_type) - 1 - __builtin_clzl(ind + FIRST_SEGMENT_) - FIRST_SEGMENT_BITS_;
+  }
+
+  static size_type offset_in_(size_type ind, size_type k) noexcept {
+      return ind + FIRST_SEGMENT_ - seg_len_(k);
+  }
+
+  // strong, safe to call concurrently: losers of the race free their segment
+  mix_ptr get_segment_(size_type k) {
+      mix_ptr seg = segments_[k].load(std::memory_order_acquire);
+      if (seg != nullptr) {
+          return seg;
+      }
+      mix_ptr alloc_mem = reinterpret_cast<mix_ptr>(
+          operator new(flags_bytes_(k) + seg_len_(k) * sizeof(value_type)));
+      for (size_type i = 0; i != seg_len_(k); ++i) {
+          new(seg_flags_(alloc_mem) + i) std::atomic<unsigned char>(0);
+      }
+      if (segments_[k].compare_exchange_strong(seg, alloc_mem, std::memory_order_acq_rel)) {
+          return alloc_mem;
+      }
+      operator delete(static_cast<void *>(alloc_mem));
+      return seg;
+  }
+
+  public:
+  concurrent_vector() noexcept = default;
+  concurrent_vector(concurrent_vector const &) = delete;
+  concurrent_vector &operator=(concurrent_vector const &) = delete;
+
+  ~concurrent_vector() {
+      clear();
+  }
+
+  // basic, thread safe; if copying elem throws the reserved slot stays unpublished
+  size_type push_back(const_reference elem) {
+      size_type ind = size_.fetch_add(1, std::memory_order_relaxed);
+      size_type k = segment_of_(ind);
+      mix_ptr seg = get_segment_(k);
+      new(seg_data_(seg, k) + offset_in_(ind, k)) value_type(elem);
+      seg_flags_(seg)[offset_in_(ind, k)].store(1, std::memory_order_release);
+      return ind;
+  }
+
+  // number of reserved slots, some of them may be not published yet
+  size_type size() const noexcept {
+      return size_.load(std::memory_order_acquire);
+  }
+
+  bool is_published(size_type ind) const noexcept {
+      if (ind >= size()) {
+          return false;
+      }
+      size_type k = segment_of_(ind);
+      mix_ptr seg = segments_[k].load(std::memory_order_acquire);
+      return seg != nullptr &&
+          seg_flags_(seg)[offset_in_(ind, k)].load(std::memory_order_acquire) != 0;
+  }
+
+  // ind must be published
+  reference operator[](size_type ind) noexcept {
+      assert(is_published(ind));
+      size_type k = segment_of_(ind);
+      return seg_data_(segments_[k].load(std::memory_order_acquire), k)[offset_in_(ind, k)];
+  }
+
+  const_reference operator[](size_type ind) const noexcept {
+      assert(is_published(ind));
+      size_type k = segment_of_(ind);
+      return seg_data_(segments_[k].load(std::memory_order_acquire), k)[offset_in_(ind, k)];
+  }
+
+  // not thread safe, noexcept if only if ~vaule_type() nothrow
+  void clear() {
+      size_type sz = size_.load(std::memory_order_relaxed);
+      for (size_type k = 0; k != SEGMENTS_; ++k) {
+          mix_ptr seg = segments_[k].load(std::memory_order_relaxed);
+          if (seg == nullptr) {
+              continue;
+          }
+          size_type first = seg_len_(k) - FIRST_SEGMENT_;
+          for (size_type i = 0; i != seg_len_(k) && first + i < sz; ++i) {
+              if (seg_flags_(seg)[i].load(std::memory_order_relaxed) != 0) {
+                  std::destroy_at(seg_data_(seg, k) + i);
+              }
+          }
+          operator delete(static_cast<void *>(seg));
+          segments_[k].store(nullptr, std::memory_order_relaxed);
+      }
+      size_.store(0, std::memory_order_relaxed);
+  }
+};
+
+#endif //SUPER_VECTOR__CONCURRENT_VECTOR_HPP_
@@ -0,0 +1,353 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__FLAT_MAP_HPP_
+#define SUPER_VECTOR__FLAT_MAP_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "vector.hpp"
+
+// Sorted-vector set and map. Keys and mapped values are kept in separate vectors,
+// so a lookup only touches the keys; copies share both buffers through COW and
+// lookups read the const data, so they never detach. With search_layout::eytzinger
+// an extra copy of the keys is kept in BFS order, which makes the top levels of
+// every search hit the same few cache lines. The copy is built by the range insert
+// and build_layout(); a single-key insert or erase only marks it stale and lookups
+// use the branchless search until the next rebuild, so the layout suits maps that
+// are built in bulk and queried many times.
+
+enum class search_layout {
+  branchless,
+  eytzinger
+};
+
+namespace flat_detail {
+
+// index of the first element of sorted [p, p + n) not less than key
+template<typename K, typename Compare>
+size_t branchless_lower_bound(K const *p, size_t n, K const &key, Compare const &comp) {
+    if (n == 0) {
+        return 0;
+    }
+    K const *base = p;
+    while (n > 1) {
+        size_t half = n / 2;
+        base = comp(base[half], key) ? base + half : base;
+        n -= half;
+    }
+    return (base - p) + comp(*base, key);
+}
+
+template<typename K, typename Compare, search_layout Layout>
+class sorted_keys {
+  public:
+  typedef K const *const_iterator;
+
+  size_t size() const noexcept {
+      return keys_.size();
+  }
+
+  const_iterator begin() const noexcept {
+      return keys_.data();
+  }
+
+  const_iterator end() const noexcept {
+      return keys_.data() + keys_.size();
+  }
+
+  vector<K> const &keys() const noexcept {
+      return keys_;
+  }
+
+  size_t lower_bound(K const &key) const {
+      if constexpr (Layout == search_layout::eytzinger) {
+          if (!stale_) {
+              K const *eyt = eyt_keys_.data();
+              size_t n = eyt_keys_.size();
+              size_t k = 1;
+              while (k <= n) {
+                  k = 2 * k + comp_(eyt[k - 1], key);
+              }
+              k >>= __builtin_ffsll(~static_cast<long long>(k));
+              return k == 0 ? n : eyt_index_[k - 1];
+          }
+      }
+      return branchless_lower_bound(keys_.data(), keys_.size(), key, comp_);
+  }
+
+  // index of key or size() if absent
+  size_t find(K const &key) const {
+      size_t ind = lower_bound(key);
+      return ind != size() && !comp_(key, keys_[ind]) ? ind : size();
+  }
+
+  // O(n), rebuilds the eytzinger copy after single-key changes; strong
+  void build_layout() {
+      if constexpr (Layout == search_layout::eytzinger) {
+          if (!stale_) {
+              return;
+          }
+          size_t n = keys_.size();
+          vector<size_t> index;
+          index.resize(n);
+          size_t next = 0;
+          fill_eytzinger_(index.data(), n, 1, next);
+          vector<K> eyt;
+          eyt.reserve(n);
+          K const *sorted = std::as_const(keys_).data();
+          for (size_t k = 0; k != n; ++k) {
+              eyt.push_back(sorted[std::as_const(index)[k]]);
+          }
+          eyt_keys_.swap(eyt);
+          eyt_index_.swap(index);
+          stale_ = false;
+      }
+  }
+
+  protected:
+  vector<K> keys_;
+  Compare comp_;
+
+  // called after a bulk change of keys_
+  void rebuild_() {
+      stale_ = true;
+      build_layout();
+  }
+
+  // called after a single-key change of keys_, lookups fall back to the branchless search
+  void invalidate_() noexcept {
+      stale_ = true;
+  }
+
+  private:
+  vector<K> eyt_keys_;
+  vector<size_t> eyt_index_;
+  bool stale_ = false;
+
+  // in-order walk over the implicit tree assigns sorted positions to BFS slots
+  static void fill_eytzinger_(size_t *index, size_t n, size_t k, size_t &next) {
+      if (k <= n) {
+          fill_eytzinger_(index, n, 2 * k, next);
+          index[k - 1] = next++;
+          fill_eytzinger_(index, n, 2 * k + 1, next);
+      }
+  }
+};
+
+} // namespace flat_detail
+
+template<typename K, typename Compare = std::less<K>,
+    search_layout Layout = search_layout::branchless>
+class flat_set : public flat_detail::sorted_keys<K, Compare, Layout> {
+  typedef flat_detail::sorted_keys<K, Compare, Layout> base;
+  using base::keys_;
+  using base::comp_;
+  public:
+  bool empty() const noexcept {
+      return this->size() == 0;
+  }
+
+  bool contains(K const &key) const {
+      return base::find(key) != this->size();
+  }
+
+  size_t count(K const &key) const {
+      return contains(key) ? 1 : 0;
+  }
+
+  // returns false if the key is already present
+  bool insert(K const &key) {
+      size_t ind = this->lower_bound(key);
+      if (ind != this->size() && !comp_(key, std::as_const(keys_)[ind])) {
+          return false;
+      }
+      keys_.insert(std::as_const(keys_).begin() + ind, key);
+      this->invalidate_();
+      return true;
+  }
+
+  // sort the new keys, then merge them with the existing ones in one pass
+  template<typename InputIterator,
+      typename = typename std::iterator_traits<InputIterator>::iterator_category>
+  void insert(InputIterator first, InputIterator last) {
+      std::vector<K> fresh(first, last);
+      if (fresh.empty()) {
+          return;
+      }
+      std::stable_sort(fresh.begin(), fresh.end(), comp_);
+      vector<K> merged;
+      merged.reserve(this->size() + fresh.size());
+      K const *old = std::as_const(keys_).data();
+      size_t i = 0;
+      size_t n = this->size();
+      for (K const &key : fresh) {
+          for (; i != n && comp_(old[i], key); ++i) {
+              merged.push_back(old[i]);
+          }
+          bool present = (i != n && !comp_(key, old[i]))
+              || (merged.size() != 0 && !comp_(merged.back(), key));
+          if (!present) {
+              merged.push_back(key);
+          }
+      }
+      for (; i != n; ++i) {
+          merged.push_back(old[i]);
+      }
+      keys_.swap(merged);
+      this->rebuild_();
+  }
+
+  size_t erase(K const &key) {
+      size_t ind = base::find(key);
+      if (ind == this->size()) {
+          return 0;
+      }
+      keys_.erase(std::as_const(keys_).begin() + ind);
+      this->invalidate_();
+      return 1;
+  }
+
+  void clear() {
+      keys_.clear();
+      this->rebuild_();
+  }
+};
+
+template<typename K, typename V, typename Compare = std::less<K>,
+    search_layout Layout = search_layout::branchless>
+class flat_map : public flat_detail::sorted_keys<K, Compare, Layout> {
+  typedef flat_detail::sorted_keys<K, Compare, Layout> base;
+  using base::keys_;
+  using base::comp_;
+  public:
+  bool empty() const noexcept {
+      return this->size() == 0;
+  }
+
+  bool contains(K const &key) const {
+      return base::find(key) != this->size();
+  }
+
+  vector<V> const &values() const noexcept {
+      return values_;
+  }
+
+  // nullptr if the key is absent
+  V const *find(K const &key) const {
+      size_t ind = base::find(key);
+      return ind == this->size() ? nullptr : values_.data() + ind;
+  }
+
+  // detaches the values only, keys stay shared
+  V *find(K const &key) {
+      size_t ind = base::find(key);
+      return ind == this->size() ? nullptr : values_.data() + ind;
+  }
+
+  V const &at(K const &key) const {
+      V const *value = find(key);
+      if (value == nullptr) {
+          throw std::out_of_range("flat_map::at");
+      }
+      return *value;
+  }
+
+  V &operator[](K const &key) {
+      size_t ind = this->lower_bound(key);
+      if (ind == this->size() || comp_(key, std::as_const(keys_)[ind])) {
+          insert_at_(ind, key, V());
+      }
+      return values_[ind];
+  }
+
+  // returns false if the key is already present, the old value is kept then
+  bool insert(K const &key, V const &value) {
+      size_t ind = this->lower_bound(key);
+      if (ind != this->size() && !comp_(key, std::as_const(keys_)[ind])) {
+          return false;
+      }
+      insert_at_(ind, key, value);
+      return true;
+  }
+
+  // pairs of key and value; sort the new ones, then merge in one pass
+  template<typename InputIterator,
+      typename = typename std::iterator_traits<InputIterator>::iterator_category>
+  void insert(InputIterator first, InputIterator last) {
+      std::vector<std::pair<K, V>> fresh(first, last);
+      if (fresh.empty()) {
+          return;
+      }
+      Compare comp = comp_;
+      std::stable_sort(fresh.begin(), fresh.end(),
+                       [&comp](std::pair<K, V> const &a, std::pair<K, V> const &b) {
+                           return comp(a.first, b.first);
+                       });
+      vector<K> keys;
+      vector<V> values;
+      keys.reserve(this->size() + fresh.size());
+      values.reserve(this->size() + fresh.size());
+      K const *old_keys = std::as_const(keys_).data();
+      V const *old_values = std::as_const(values_).data();
+      size_t i = 0;
+      size_t n = this->size();
+      for (std::pair<K, V> const &kv : fresh) {
+          for (; i != n && comp_(old_keys[i], kv.first); ++i) {
+              keys.push_back(old_keys[i]);
+              values.push_back(old_values[i]);
+          }
+          bool present = (i != n && !comp_(kv.first, old_keys[i]))
+              || (keys.size() != 0 && !comp_(keys.back(), kv.first));
+          if (!present) {
+              keys.push_back(kv.first);
+              values.push_back(kv.second);
+          }
+      }
+      for (; i != n; ++i) {
+          keys.push_back(old_keys[i]);
+          values.push_back(old_values[i]);
+      }
+      keys_.swap(keys);
+      values_.swap(values);
+      this->rebuild_();
+  }
+
+  size_t erase(K const &key) {
+      size_t ind = base::find(key);
+      if (ind == this->size()) {
+          return 0;
+      }
+      keys_.erase(std::as_const(keys_).begin() + ind);
+      values_.erase(std::as_const(values_).begin() + ind);
+      this->invalidate_();
+      return 1;
+  }
+
+  void clear() {
+      keys_.clear();
+      values_.clear();
+      this->rebuild_();
+  }
+
+  private:
+  vector<V> values_;
+
+  void insert_at_(size_t ind, K const &key, V const &value) {
+      values_.insert(std::as_const(values_).begin() + ind, value);
+      try {
+          keys_.insert(std::as_const(keys_).begin() + ind, key);
+      } catch (...) {
+          values_.erase(std::as_const(values_).begin() + ind);
+          throw;
+      }
+      this->invalidate_();
+  }
+};
+
+#endif //SUPER_VECTOR__FLAT_MAP_HPP_
@@ -0,0 +1,89 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__MAPPED_VECTOR_HPP_
+#define SUPER_VECTOR__MAPPED_VECTOR_HPP_
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "vector.hpp"
+#include "vector_format.hpp"
+
+// Read-only view of a file written by serialize(). The file is mapped privately and
+// the block header is written into the padding in front of the data, so reads go
+// straight to the page cache and the first write copies the elements to the heap.
+// The returned vector is an ordinary vector<T>: copies share the mapping and the last
+// owner unmaps it, see vector::is_mapped.
+namespace mapped_detail {
+
+inline void unmap(void *base, size_t length) noexcept {
+    ::munmap(base, length);
+}
+
+} // namespace mapped_detail
+
+// strong, throws std::system_error if the file cannot be mapped and std::runtime_error
+// if it is not a serialized vector of T
+template<typename T>
+vector<T> map_file(char const *path) {
+    static_assert(std::is_trivially_copyable<T>::value, "trivially copyable value_type expected");
+    static_assert(vector<T>::HEADER_SIZE_ <= vector_format::MAX_BLOCK_HEADER,
+                  "block header does not fit the format bound");
+    typedef typename vector<T>::mapping_ mapping;
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), path);
+    }
+    size_t length = st.st_size;
+    if (length < sizeof(vector_format::file_header)) {
+        ::close(fd);
+        throw std::runtime_error("not a serialized vector");
+    }
+    void *base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        throw std::system_error(err, std::generic_category(), path);
+    }
+    vector<T> result;
+    try {
+        vector_format::file_header h;
+        std::memcpy(&h, base, sizeof(h));
+        vector_format::check_header(h, sizeof(T));
+        if (h.data_offset < vector<T>::HEADER_SIZE_ + sizeof(mapping) || h.data_offset % 64 != 0) {
+            throw std::runtime_error("no room for a block header in front of the data");
+        }
+        if (h.data_offset > length || h.count > (length - h.data_offset) / sizeof(T)) {
+            throw std::runtime_error("truncated vector file");
+        }
+        if (h.count != 0) {
+            char *block = static_cast<char *>(base) + h.data_offset - vector<T>::HEADER_SIZE_;
+            new(block - sizeof(mapping)) mapping{base, length, &mapped_detail::unmap};
+            result.set_header_(block, h.count, h.count, vector<T>::FOREIGN_ | 1);
+            result.variant_ = block;
+            return result;
+        }
+    } catch (...) {
+        ::munmap(base, length);
+        throw;
+    }
+    ::munmap(base, length);
+    return result;
+}
+
+#endif //SUPER_VECTOR__MAPPED_VECTOR_HPP_
@@ -0,0 +1,276 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__PAGED_VECTOR_HPP_
+#define SUPER_VECTOR__PAGED_VECTOR_HPP_
+
+#include <memory>
+#include <algorithm>
+#include <assert.h>
+
+// Copy-on-write vector stored as a table of fixed-size pages. The table and every
+// page carry their own reference counter, so the first write to a shared vector
+// clones the page table and the single touched page instead of the whole data.
+template<typename T, size_t PAGE_BYTES = 4096>
+class paged_vector {
+  public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef T const *const_pointer;
+  typedef T &reference;
+  typedef T const &const_reference;
+  typedef size_t size_type;
+  private:
+  typedef char *mix_ptr;
+  static constexpr size_type PAGE_SIZE_ = PAGE_BYTES / sizeof(T) == 0 ? 1 : PAGE_BYTES / sizeof(T);
+  static constexpr size_type DEFAULT_TABLE_CAPACITY_ = 4;
+
+  // table: [size][capacity in pages][ref][page pointers]
+  // page:  [ref][data]
+  mix_ptr table_ = nullptr;
+
+  // _____________________________________________________________________________________________
+  // service function
+
+  static mix_ptr allocate(size_type n) {
+      return reinterpret_cast<mix_ptr>(operator new(n));
+  }
+
+  static void free_empty_memory(mix_ptr ptr) {
+      operator delete(static_cast<void *>(ptr));
+  }
+
+  static size_type &tab_size_(mix_ptr ptr) noexcept {
+      return *reinterpret_cast<size_type *>(ptr);
+  }
+
+  static size_type &tab_cap_(mix_ptr ptr) noexcept {
+      return *reinterpret_cast<size_type *>(ptr + sizeof(size_type));
+  }
+
+  static size_type &tab_ref_(mix_ptr ptr) noexcept {
+      return *reinterpret_cast<size_type *>(ptr + 2 * sizeof(size_type));
+  }
+
+  static mix_ptr *tab_pages_(mix_ptr ptr) noexcept {
+      return reinterpret_cast<mix_ptr *>(ptr + 3 * sizeof(size_type));
+  }
+
+  static size_type &page_ref_(mix_ptr page) noexcept {
+      return *reinterpret_cast<size_type *>(page);
+  }
+
+  static pointer page_data_(mix_ptr page) noexcept {
+      return reinterpret_cast<pointer>(page + sizeof(size_type));
+  }
+
+  static mix_ptr allocate_table(size_type cap) {
+      return allocate(3 * sizeof(size_type) + cap * sizeof(mix_ptr));
+  }
+
+  static mix_ptr allocate_page() {
+      mix_ptr page = allocate(sizeof(size_type) + PAGE_SIZE_ * sizeof(value_type));
+      page_ref_(page) = 1;
+      return page;
+  }
+
+  static size_type page_count_(size_type sz) noexcept {
+      return (sz + PAGE_SIZE_ - 1) / PAGE_SIZE_;
+  }
+
+  // number of constructed elements in page p of a table with size sz
+  static size_type page_fill_(size_type sz, size_type p) noexcept {
+      return std::min(PAGE_SIZE_, sz - p * PAGE_SIZE_);
+  }
+
+  // noexcept if only if value_type destruction nothrow
+  static void cut_page_link_(mix_ptr page, size_type fill) {
+      if (--page_ref_(page) == 0) {
+          std::destroy(page_data_(page), page_data_(page) + fill);
+          free_empty_memory(page);
+      }
+  }
+
+  // noexcept if only if value_type destruction nothrow
+  static void cut_table_link_(mix_ptr table) {
+      if (--tab_ref_(table) == 0) {
+          size_type sz = tab_size_(table);
+          for (size_type p = 0; p != page_count_(sz); ++p) {
+              cut_page_link_(tab_pages_(table)[p], page_fill_(sz, p));
+          }
+          free_empty_memory(table);
+      }
+  }
+
+  // strong, clones only the page pointers, pages become shared
+  void make_table_unique_(size_type new_cap) {
+      mix_ptr old = table_;
+      mix_ptr table = allocate_table(new_cap);
+      size_type pages = page_count_(tab_size_(old));
+      std::uninitialized_copy(tab_pages_(old), tab_pages_(old) + pages, tab_pages_(table));
+      for (size_type p = 0; p != pages; ++p) {
+          ++page_ref_(tab_pages_(table)[p]);
+      }
+      tab_size_(table) = tab_size_(old);
+      tab_cap_(table) = new_cap;
+      tab_ref_(table) = 1;
+      table_ = table;
+      cut_table_link_(old); // table was shared or replaced, page refs were bumped
+  }
+
+  // strong
+  void make_table_unique_() {
+      if (tab_ref_(table_) != 1) {
+          make_table_unique_(tab_cap_(table_));
+      }
+  }
+
+  // strong, table must be unique
+  mix_ptr make_page_unique_(size_type p) {
+      mix_ptr &slot = tab_pages_(table_)[p];
+      if (page_ref_(slot) == 1) {
+          return slot;
+      }
+      mix_ptr page = allocate_page();
+      size_type fill = page_fill_(size(), p);
+      try {
+          std::uninitialized_copy(page_data_(slot), page_data_(slot) + fill, page_data_(page));
+      } catch (...) {
+          free_empty_memory(page);
+          throw;
+      }
+      cut_page_link_(slot, fill); // page was shared, nothing is destroyed
+      slot = page;
+      return page;
+  }
+
+  public:
+  paged_vector() noexcept = default;
+
+  paged_vector(paged_vector const &other) noexcept : table_(other.table_) {
+      if (table_ != nullptr) {
+          ++tab_ref_(table_);
+      }
+  }
+
+  paged_vector &operator=(paged_vector const &other) {
+      paged_vector(other).swap(*this);
+      return *this;
+  }
+
+  ~paged_vector() {
+      clear();
+  }
+
+  size_type size() const noexcept {
+      return table_ == nullptr ? 0 : tab_size_(table_);
+  }
+
+  bool empty() const noexcept {
+      return size() == 0;
+  }
+
+  static constexpr size_type page_size() noexcept {
+      return PAGE_SIZE_;
+  }
+
+  size_type page_count() const noexcept {
+      return page_count_(size());
+  }
+
+  const_pointer page_data(size_type p) const noexcept {
+      return page_data_(tab_pages_(table_)[p]);
+  }
+
+  // O(1) frozen copy, a write to either side detaches the table and the touched page;
+  // copy and destroy it on the owner's thread, the counters are not atomic
+  paged_vector snapshot() const noexcept {
+      return *this;
+  }
+
+  bool is_page_shared(size_type p) const noexcept {
+      return tab_ref_(table_) != 1 || page_ref_(tab_pages_(table_)[p]) != 1;
+  }
+
+  const_reference operator[](size_type ind) const noexcept {
+      return page_data(ind / PAGE_SIZE_)[ind % PAGE_SIZE_];
+  }
+
+  // strong, detaches the table and the page holding ind only
+  reference operator[](size_type ind) {
+      make_table_unique_();
+      return page_data_(make_page_unique_(ind / PAGE_SIZE_))[ind % PAGE_SIZE_];
+  }
+
+  const_reference back() const noexcept {
+      return (*this)[size() - 1];
+  }
+
+  reference back() {
+      return (*this)[size() - 1];
+  }
+
+  // strong
+  void push_back(const_reference elem) {
+      value_type copy(elem);
+      if (table_ == nullptr) {
+          table_ = allocate_table(DEFAULT_TABLE_CAPACITY_);
+          tab_size_(table_) = 0;
+          tab_cap_(table_) = DEFAULT_TABLE_CAPACITY_;
+          tab_ref_(table_) = 1;
+      }
+      size_type sz = size();
+      if (sz % PAGE_SIZE_ == 0) {
+          size_type pages = page_count_(sz);
+          if (tab_ref_(table_) != 1 || pages == tab_cap_(table_)) {
+              make_table_unique_(pages == tab_cap_(table_) ? 2 * pages : tab_cap_(table_));
+          }
+          mix_ptr page = allocate_page();
+          try {
+              new(page_data_(page)) value_type(copy);
+          } catch (...) {
+              free_empty_memory(page);
+              throw;
+          }
+          tab_pages_(table_)[pages] = page;
+      } else {
+          make_table_unique_();
+          mix_ptr page = make_page_unique_(sz / PAGE_SIZE_);
+          new(page_data_(page) + sz % PAGE_SIZE_) value_type(copy);
+      }
+      ++tab_size_(table_);
+  }
+
+  // strong
+  void pop_back() {
+      make_table_unique_();
+      size_type sz = size();
+      size_type p = (sz - 1) / PAGE_SIZE_;
+      if ((sz - 1) % PAGE_SIZE_ == 0) {
+          cut_page_link_(tab_pages_(table_)[p], 1);
+      } else {
+          std::destroy_at(page_data_(make_page_unique_(p)) + (sz - 1) % PAGE_SIZE_);
+      }
+      --tab_size_(table_);
+  }
+
+  // noexcept if only if ~vaule_type() nothrow
+  void clear() {
+      if (table_ != nullptr) {
+          cut_table_link_(table_);
+          table_ = nullptr;
+      }
+  }
+
+  void swap(paged_vector &other) noexcept {
+      std::swap(table_, other.table_);
+  }
+};
+
+template<typename T, size_t PAGE_BYTES>
+void swap(paged_vector<T, PAGE_BYTES> &a, paged_vector<T, PAGE_BYTES> &b) noexcept {
+    a.swap(b);
+}
+
+#endif //SUPER_VECTOR__PAGED_VECTOR_HPP_
@@ -0,0 +1,166 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__PARALLEL_SORT_HPP_
+#define SUPER_VECTOR__PARALLEL_SORT_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "vector.hpp"
+#include "vector_parallel.hpp"
+
+// Parallel merge sort over the contiguous buffer. The vector is detached once, the
+// buffer is cut into one chunk per thread and the chunks are sorted concurrently.
+// Sorted runs are then merged pairwise into a scratch buffer and back. Every round is
+// cut into pieces of equal output length: the split point of each piece is found by
+// a binary search over both runs (merge path), so the last round, one merge of the
+// whole buffer, still runs on every thread. All work goes to the task pool of
+// vector_parallel.hpp.
+namespace parallel_detail {
+
+// below this a single std::sort is faster than waking the pool
+constexpr size_t SERIAL_SORT_ = size_t(1) << 14;
+// smallest piece of a parallel merge
+constexpr size_t MERGE_PIECE_ = size_t(1) << 13;
+
+// number of elements of a among the first d elements of the stable merge of a and b
+template<typename T, typename Compare>
+size_t co_rank(T const *a, size_t na, T const *b, size_t nb, size_t d, Compare const &comp) {
+    size_t lo = d > nb ? d - nb : 0;
+    size_t hi = std::min(d, na);
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        // a[i] is taken before b[d - i - 1] unless b[d - i - 1] is strictly less
+        if (!comp(b[d - i - 1], a[i])) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// scratch space of n elements, trivial types are left uninitialized
+template<typename T>
+class merge_buffer {
+  public:
+  merge_buffer(T const *p, size_t n) {
+      if constexpr (std::is_trivial<T>::value) {
+          trivial_.reset(new T[n]);
+          data_ = trivial_.get();
+      } else {
+          other_.assign(p, p + n);
+          data_ = other_.data();
+      }
+  }
+
+  T *data() const noexcept {
+      return data_;
+  }
+
+  private:
+  std::unique_ptr<T[]> trivial_;
+  std::vector<T> other_;
+  T *data_;
+};
+
+// one piece of a merge round: output [first, last) of the merge of the runs at
+// bounds[run] and bounds[run + width], or a copy of a run without a partner
+struct merge_piece {
+  size_t run;
+  size_t first;
+  size_t last;
+};
+
+template<typename T, typename Compare, typename ChunkSort>
+void merge_sort(task_pool &pool, T *p, size_t n, Compare const &comp, size_t threads,
+                ChunkSort const &chunk_sort) {
+    if (threads == 0 || threads > pool.concurrency()) {
+        threads = pool.concurrency();
+    }
+    size_t chunks = std::min(threads, n / SERIAL_SORT_);
+    if (chunks <= 1) {
+        chunk_sort(p, p + n);
+        return;
+    }
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t i = 0; i <= chunks; ++i) {
+        bounds[i] = n / chunks * i + std::min(i, n % chunks);
+    }
+    merge_buffer<T> buffer(p, n);
+    pool.run(chunks, [&](size_t i) {
+        chunk_sort(p + bounds[i], p + bounds[i + 1]);
+    }, threads);
+
+    size_t piece = std::max(MERGE_PIECE_, (n + threads - 1) / threads);
+    T *src = p;
+    T *dst = buffer.data();
+    std::vector<merge_piece> pieces;
+    for (size_t width = 1; width < chunks; width *= 2) {
+        pieces.clear();
+        for (size_t run = 0; run < chunks; run += 2 * width) {
+            size_t length = bounds[std::min(run + 2 * width, chunks)] - bounds[run];
+            for (size_t first = 0; first < length; first += piece) {
+                pieces.push_back({run, first, std::min(first + piece, length)});
+            }
+        }
+        pool.run(pieces.size(), [&](size_t k) {
+            merge_piece const &mp = pieces[k];
+            size_t lo = bounds[mp.run];
+            size_t mid = bounds[std::min(mp.run + width, chunks)];
+            size_t hi = bounds[std::min(mp.run + 2 * width, chunks)];
+            T *a = src + lo;
+            T *b = src + mid;
+            size_t na = mid - lo;
+            size_t nb = hi - mid;
+            size_t i0 = co_rank(a, na, b, nb, mp.first, comp);
+            size_t i1 = co_rank(a, na, b, nb, mp.last, comp);
+            std::merge(std::make_move_iterator(a + i0), std::make_move_iterator(a + i1),
+                       std::make_move_iterator(b + (mp.first - i0)),
+                       std::make_move_iterator(b + (mp.last - i1)),
+                       dst + lo + mp.first, comp);
+        }, threads);
+        std::swap(src, dst);
+    }
+    if (src != p) {
+        size_t copies = (n + piece - 1) / piece;
+        pool.run(copies, [&](size_t k) {
+            size_t first = k * piece;
+            size_t last = std::min(first + piece, n);
+            std::move(src + first, src + last, p + first);
+        }, threads);
+    }
+}
+
+} // namespace parallel_detail
+
+// threads == 0 uses every pool thread; basic
+template<typename T, typename Compare = std::less<T>>
+void parallel_sort(vector<T> &v, Compare comp = Compare(), size_t threads = 0) {
+    if (v.size() < 2) {
+        return;
+    }
+    parallel_detail::merge_sort(parallel_detail::task_pool::instance(), v.data(), v.size(), comp,
+                                threads, [&comp](T *first, T *last) {
+        std::sort(first, last, comp);
+    });
+}
+
+// keeps the order of equivalent elements; basic
+template<typename T, typename Compare = std::less<T>>
+void parallel_stable_sort(vector<T> &v, Compare comp = Compare(), size_t threads = 0) {
+    if (v.size() < 2) {
+        return;
+    }
+    parallel_detail::merge_sort(parallel_detail::task_pool::instance(), v.data(), v.size(), comp,
+                                threads, [&comp](T *first, T *last) {
+        std::stable_sort(first, last, comp);
+    });
+}
+
+#endif //SUPER_VECTOR__PARALLEL_SORT_HPP_
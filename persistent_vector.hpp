@@ -0,0 +1,270 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__PERSISTENT_VECTOR_HPP_
+#define SUPER_VECTOR__PERSISTENT_VECTOR_HPP_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "vector_format.hpp"
+
+namespace persistent_detail {
+
+// every msync of a persistent_vector goes through here, tests replace it to check the
+// ranges and the order of the syncs
+inline int (*msync)(void *, size_t, int) = ::msync;
+
+} // namespace persistent_detail
+
+// Growable vector whose elements live in a MAP_SHARED file mapping, so they survive
+// restarts without a serialization step. The file uses the layout of vector_format.hpp:
+// the header count is the size and the rest of the file is capacity, so a persistent
+// file can also be read by deserialize and map_file. Growth extends the file with
+// ftruncate and the mapping with mremap. Writes reach the file when the kernel writes
+// the pages back; flush() forces that. Single owner: not copyable, movable.
+template<typename T>
+class persistent_vector {
+  static_assert(std::is_trivially_copyable<T>::value, "trivially copyable value_type expected");
+
+  public:
+  typedef T value_type;
+  typedef T *iterator;
+  typedef T const *const_iterator;
+
+  // opens path, creating an empty vector if the file is new or empty
+  explicit persistent_vector(char const *path) {
+      fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (fd_ < 0) {
+          throw std::system_error(errno, std::generic_category(), path);
+      }
+      try {
+          struct stat st;
+          if (::fstat(fd_, &st) != 0) {
+              throw std::system_error(errno, std::generic_category(), path);
+          }
+          if (st.st_size == 0) {
+              resize_file_(vector_format::DATA_OFFSET + INITIAL_CAPACITY_ * sizeof(T));
+              map_(file_length_);
+              *header_() = vector_format::make_header(sizeof(T), 0);
+          } else {
+              if (static_cast<size_t>(st.st_size) < sizeof(vector_format::file_header)) {
+                  throw std::runtime_error("not a serialized vector");
+              }
+              file_length_ = st.st_size;
+              map_(file_length_);
+              vector_format::check_header(*header_(), sizeof(T));
+              if (header_()->data_offset != vector_format::DATA_OFFSET
+                  || header_()->count > capacity()) {
+                  throw std::runtime_error("corrupted persistent vector");
+              }
+              // the checksum is not maintained across appends
+              header_()->flags &= ~vector_format::HAS_CHECKSUM;
+          }
+      } catch (...) {
+          release_();
+          throw;
+      }
+  }
+
+  persistent_vector(persistent_vector const &) = delete;
+  persistent_vector &operator=(persistent_vector const &) = delete;
+
+  persistent_vector(persistent_vector &&other) noexcept
+      : fd_(other.fd_), base_(other.base_), file_length_(other.file_length_) {
+      other.fd_ = -1;
+      other.base_ = nullptr;
+  }
+
+  persistent_vector &operator=(persistent_vector &&other) noexcept {
+      if (this != &other) {
+          release_();
+          fd_ = other.fd_;
+          base_ = other.base_;
+          file_length_ = other.file_length_;
+          other.fd_ = -1;
+          other.base_ = nullptr;
+      }
+      return *this;
+  }
+
+  // pages are written back by the kernel, call flush() first for durability
+  ~persistent_vector() {
+      release_();
+  }
+
+  size_t size() const noexcept {
+      return header_()->count;
+  }
+
+  bool empty() const noexcept {
+      return size() == 0;
+  }
+
+  size_t capacity() const noexcept {
+      return (file_length_ - vector_format::DATA_OFFSET) / sizeof(T);
+  }
+
+  T *data() noexcept {
+      return reinterpret_cast<T *>(base_ + vector_format::DATA_OFFSET);
+  }
+
+  T const *data() const noexcept {
+      return reinterpret_cast<T const *>(base_ + vector_format::DATA_OFFSET);
+  }
+
+  T &operator[](size_t i) noexcept {
+      return data()[i];
+  }
+
+  T const &operator[](size_t i) const noexcept {
+      return data()[i];
+  }
+
+  T &back() noexcept {
+      return data()[size() - 1];
+  }
+
+  iterator begin() noexcept {
+      return data();
+  }
+
+  iterator end() noexcept {
+      return data() + size();
+  }
+
+  const_iterator begin() const noexcept {
+      return data();
+  }
+
+  const_iterator end() const noexcept {
+      return data() + size();
+  }
+
+  // strong
+  void reserve(size_t new_cap) {
+      if (new_cap > capacity()) {
+          grow_(vector_format::DATA_OFFSET + new_cap * sizeof(T));
+      }
+  }
+
+  // strong, the element is written before the count, so a crash never exposes garbage
+  void push_back(T const &value) {
+      if (size() == capacity()) {
+          reserve(capacity() < INITIAL_CAPACITY_ ? INITIAL_CAPACITY_ : capacity() * 2);
+      }
+      data()[size()] = value;
+      header_()->count = size() + 1;
+  }
+
+  void pop_back() noexcept {
+      header_()->count = size() - 1;
+  }
+
+  void clear() noexcept {
+      header_()->count = 0;
+  }
+
+  // strong, gives the unused capacity back to the file system
+  void shrink_to_fit() {
+      size_t length = vector_format::DATA_OFFSET + size() * sizeof(T);
+      if (length != file_length_) {
+          grow_(length);
+      }
+  }
+
+  // blocks until the elements and then the header are on disk; the first elements share
+  // the header page, they reach the disk together with the count that covers them
+  void flush() {
+      size_t end = vector_format::DATA_OFFSET + size() * sizeof(T);
+      size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+      size_t header_page = (vector_format::DATA_OFFSET + page - 1) / page * page;
+      if (end > header_page) {
+          sync_(base_ + header_page, end - header_page);
+      }
+      sync_(base_, std::min(end, header_page));
+  }
+
+  private:
+  static constexpr size_t INITIAL_CAPACITY_ = 16;
+
+  int fd_ = -1;
+  char *base_ = nullptr;
+  size_t file_length_ = 0;
+
+  vector_format::file_header *header_() noexcept {
+      return reinterpret_cast<vector_format::file_header *>(base_);
+  }
+
+  vector_format::file_header const *header_() const noexcept {
+      return reinterpret_cast<vector_format::file_header const *>(base_);
+  }
+
+  void resize_file_(size_t length) {
+      while (::ftruncate(fd_, length) != 0) {
+          if (errno != EINTR) {
+              throw std::system_error(errno, std::generic_category(), "ftruncate");
+          }
+      }
+      file_length_ = length;
+  }
+
+  void map_(size_t length) {
+      void *p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+      if (p == MAP_FAILED) {
+          throw std::system_error(errno, std::generic_category(), "mmap");
+      }
+      base_ = static_cast<char *>(p);
+  }
+
+  // strong: the file is restored if the mapping cannot follow it
+  void grow_(size_t length) {
+      size_t old = file_length_;
+      resize_file_(length);
+#ifdef MREMAP_MAYMOVE
+      void *p = ::mremap(base_, old, length, MREMAP_MAYMOVE);
+      if (p == MAP_FAILED) {
+          int err = errno;
+          resize_file_(old);
+          throw std::system_error(err, std::generic_category(), "mremap");
+      }
+      base_ = static_cast<char *>(p);
+#else
+      void *p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+      if (p == MAP_FAILED) {
+          int err = errno;
+          resize_file_(old);
+          throw std::system_error(err, std::generic_category(), "mmap");
+      }
+      ::munmap(base_, old);
+      base_ = static_cast<char *>(p);
+#endif
+  }
+
+  void sync_(char *p, size_t n) {
+      if (persistent_detail::msync(p, n, MS_SYNC) != 0) {
+          throw std::system_error(errno, std::generic_category(), "msync");
+      }
+  }
+
+  void release_() noexcept {
+      if (base_ != nullptr) {
+          ::munmap(base_, file_length_);
+          base_ = nullptr;
+      }
+      if (fd_ >= 0) {
+          ::close(fd_);
+          fd_ = -1;
+      }
+  }
+};
+
+#endif //SUPER_VECTOR__PERSISTENT_VECTOR_HPP_
@@ -0,0 +1,198 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__PUBLISHED_VECTOR_HPP_
+#define SUPER_VECTOR__PUBLISHED_VECTOR_HPP_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdexcept>
+#include "vector.hpp"
+
+// RCU-style holder for read-mostly vectors. Writers build a new version (usually a
+// cheap COW copy of the current one) and publish it with one atomic exchange.
+// Readers only store their epoch into a private slot and load the current pointer,
+// so the shared header of the vector is never written on the read path. Retired
+// versions are destroyed by writers once no reader can still observe them.
+//
+// Every reference counter update happens on the writer side under a mutex, hence
+// readers must not copy the vector they see, only read through the const reference.
+template<typename T>
+class published_vector {
+  public:
+  typedef vector<T> vector_type;
+  static constexpr size_t MAX_READERS = 64;
+  private:
+  typedef unsigned long long epoch_type;
+
+  struct alignas(64) reader_slot {
+      std::atomic<epoch_type> epoch{0}; // 0 - not inside read section
+      std::atomic<bool> used{false};
+      unsigned depth = 0; // live snapshots, only touched by the reader's thread
+  };
+
+  struct retired_version {
+      vector_type const *version;
+      epoch_type epoch;
+  };
+
+  std::atomic<vector_type const *> current_;
+  alignas(64) std::atomic<epoch_type> epoch_{1};
+  reader_slot slots_[MAX_READERS];
+  std::mutex writer_mutex_;
+  std::vector<retired_version> retired_;
+
+  // under writer_mutex_
+  void reclaim_() {
+      epoch_type min_active = 0;
+      for (reader_slot const &slot : slots_) {
+          epoch_type e = slot.epoch.load(std::memory_order_seq_cst);
+          if (e != 0 && (min_active == 0 || e < min_active)) {
+              min_active = e;
+          }
+      }
+      size_t kept = 0;
+      for (retired_version const &r : retired_) {
+          if (min_active == 0 || r.epoch < min_active) {
+              delete r.version;
+          } else {
+              retired_[kept++] = r;
+          }
+      }
+      retired_.resize(kept);
+  }
+
+  // strong, under writer_mutex_
+  void replace_(vector_type const &next) {
+      retired_.reserve(retired_.size() + 1);
+      vector_type const *old = current_.exchange(new vector_type(next), std::memory_order_seq_cst);
+      retired_.push_back({old, epoch_.fetch_add(1, std::memory_order_seq_cst)});
+      reclaim_();
+  }
+
+  public:
+  class reader;
+
+  // read section, the version stays alive until the snapshot is destroyed; snapshots
+  // of one reader nest, the slot keeps the epoch of the outermost one
+  class snapshot {
+    public:
+    snapshot(snapshot const &) = delete;
+    snapshot &operator=(snapshot const &) = delete;
+
+    ~snapshot() {
+        if (--slot_->depth == 0) {
+            slot_->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    vector_type const &operator*() const noexcept {
+        return *version_;
+    }
+
+    vector_type const *operator->() const noexcept {
+        return version_;
+    }
+
+    private:
+    friend class reader;
+
+    snapshot(reader_slot *slot, vector_type const *version) noexcept
+        : slot_(slot), version_(version) {}
+
+    reader_slot *slot_;
+    vector_type const *version_;
+  };
+
+  // per-thread handle, owns one reader slot
+  class reader {
+    public:
+    reader(reader const &) = delete;
+    reader &operator=(reader const &) = delete;
+
+    ~reader() {
+        slot_->used.store(false, std::memory_order_release);
+    }
+
+    // wait-free, no read-modify-write on shared cache lines. A nested read keeps the
+    // older epoch, which also protects every version published after it.
+    snapshot read() const noexcept {
+        if (slot_->depth++ == 0) {
+            slot_->epoch.store(owner_->epoch_.load(std::memory_order_acquire),
+                               std::memory_order_seq_cst);
+        }
+        return snapshot(slot_, owner_->current_.load(std::memory_order_seq_cst));
+    }
+
+    private:
+    friend class published_vector;
+
+    reader(published_vector const *owner, reader_slot *slot) noexcept
+        : owner_(owner), slot_(slot) {}
+
+    published_vector const *owner_;
+    reader_slot *slot_;
+  };
+
+  published_vector() : current_(new vector_type()) {}
+
+  explicit published_vector(vector_type const &initial) : current_(new vector_type(initial)) {}
+
+  published_vector(published_vector const &) = delete;
+  published_vector &operator=(published_vector const &) = delete;
+
+  // no readers may be active
+  ~published_vector() {
+      for (retired_version const &r : retired_) {
+          delete r.version;
+      }
+      delete current_.load();
+  }
+
+  // throws std::runtime_error if all MAX_READERS slots are taken
+  reader make_reader() {
+      for (reader_slot &slot : slots_) {
+          bool expected = false;
+          if (slot.used.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+              return reader(this, &slot);
+          }
+      }
+      throw std::runtime_error("too many readers");
+  }
+
+  // writer side: COW copy of the current version
+  vector_type load() {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      return *current_.load(std::memory_order_acquire);
+  }
+
+  // strong
+  void publish(vector_type const &next) {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      replace_(next);
+  }
+
+  // strong, f gets a COW copy of the current version and may modify it
+  template<typename F>
+  void update(F f) {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      vector_type next(*current_.load(std::memory_order_acquire));
+      f(next);
+      replace_(next);
+  }
+
+  // destroys retired versions which are no longer observed by readers
+  void collect() {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      reclaim_();
+  }
+
+  size_t retired_count() {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      return retired_.size();
+  }
+};
+
+#endif //SUPER_VECTOR__PUBLISHED_VECTOR_HPP_
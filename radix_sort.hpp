@@ -0,0 +1,211 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__RADIX_SORT_HPP_
+#define SUPER_VECTOR__RADIX_SORT_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "vector.hpp"
+
+// Stable LSD radix sort for numeric vectors and for trivially copyable elements
+// sorted by an extracted numeric key. Keys are mapped to unsigned integers whose
+// order matches the key order (sign bit flipped for signed integers, all bits
+// flipped for negative floats). One read computes the histograms of every digit;
+// a digit shared by all keys is skipped. Scatter passes ping-pong between the
+// detached buffer and a scratch buffer borrowed from a per-thread pool.
+namespace radix_detail {
+
+template<typename K, typename = void>
+struct key_bits;
+
+template<typename K>
+struct key_bits<K, typename std::enable_if<std::is_integral<K>::value>::type> {
+  typedef typename std::make_unsigned<K>::type type;
+
+  static type get(K key) noexcept {
+      type bits = static_cast<type>(key);
+      if constexpr (std::is_signed<K>::value) {
+          bits ^= type(1) << (sizeof(K) * 8 - 1);
+      }
+      return bits;
+  }
+};
+
+template<typename K>
+struct key_bits<K, typename std::enable_if<std::is_floating_point<K>::value>::type> {
+  typedef typename std::conditional<sizeof(K) == 4, uint32_t, uint64_t>::type type;
+  static_assert(sizeof(K) == sizeof(type), "unsupported floating point type");
+
+  static type get(K key) noexcept {
+      type bits;
+      std::memcpy(&bits, &key, sizeof(K));
+      type sign = type(1) << (sizeof(K) * 8 - 1);
+      return (bits & sign) ? ~bits : bits | sign;
+  }
+};
+
+// one cached buffer per thread, reused by every sort that fits in it; buffers above
+// MAX_CACHED bytes are freed on release, so one huge sort does not pin its scratch
+// memory for the lifetime of the thread
+class scratch_pool {
+  public:
+  static constexpr size_t MAX_CACHED = size_t(64) << 20;
+
+  static scratch_pool &local() {
+      static thread_local scratch_pool pool;
+      return pool;
+  }
+
+  scratch_pool() = default;
+  scratch_pool(scratch_pool const &) = delete;
+  scratch_pool &operator=(scratch_pool const &) = delete;
+
+  ~scratch_pool() {
+      operator delete(buffer_);
+  }
+
+  // at least bytes, which is set to the real size of the buffer to pass to release
+  void *acquire(size_t &bytes) {
+      if (buffer_ != nullptr && bytes <= capacity_) {
+          void *p = buffer_;
+          bytes = capacity_;
+          buffer_ = nullptr;
+          return p;
+      }
+      return operator new(bytes);
+  }
+
+  // keeps the larger of the returned and the cached buffer up to MAX_CACHED bytes
+  void release(void *p, size_t bytes) noexcept {
+      if (bytes <= MAX_CACHED && (buffer_ == nullptr || capacity_ < bytes)) {
+          operator delete(buffer_);
+          buffer_ = p;
+          capacity_ = bytes;
+      } else {
+          operator delete(p);
+      }
+  }
+
+  // frees the cached buffer
+  void trim() noexcept {
+      operator delete(buffer_);
+      buffer_ = nullptr;
+  }
+
+  size_t cached_bytes() const noexcept {
+      return buffer_ == nullptr ? 0 : capacity_;
+  }
+
+  private:
+  void *buffer_ = nullptr;
+  size_t capacity_ = 0;
+};
+
+template<typename T>
+struct scratch {
+  explicit scratch(size_t n) : bytes_(n * sizeof(T)),
+                               data(static_cast<T *>(scratch_pool::local().acquire(bytes_))) {}
+
+  scratch(scratch const &) = delete;
+  scratch &operator=(scratch const &) = delete;
+
+  ~scratch() {
+      scratch_pool::local().release(data, bytes_);
+  }
+
+  private:
+  size_t bytes_;
+
+  public:
+  T *data;
+};
+
+// below this std::stable_sort on the mapped keys wins over clearing the histograms
+constexpr size_t SMALL_SORT_ = 256;
+
+template<unsigned Bits, typename T, typename Key>
+void lsd_sort(T *p, size_t n, Key const &key) {
+    static_assert(Bits == 8 || Bits == 11 || Bits == 16, "8, 11 or 16 bit digits expected");
+    static_assert(std::is_trivially_copyable<T>::value, "trivially copyable elements expected");
+    typedef typename std::decay<decltype(key(*p))>::type key_type;
+    typedef key_bits<key_type> traits;
+    typedef typename traits::type bits_type;
+    auto bits_of = [&key](T const &x) {
+        return traits::get(key(x));
+    };
+    if (n < SMALL_SORT_) {
+        std::stable_sort(p, p + n, [&bits_of](T const &a, T const &b) {
+            return bits_of(a) < bits_of(b);
+        });
+        return;
+    }
+    constexpr size_t RADIX = size_t(1) << Bits;
+    constexpr bits_type MASK = static_cast<bits_type>(RADIX - 1);
+    constexpr unsigned PASSES = (sizeof(bits_type) * 8 + Bits - 1) / Bits;
+    std::vector<size_t> counts(PASSES * RADIX);
+    for (size_t i = 0; i != n; ++i) {
+        bits_type bits = bits_of(p[i]);
+        for (unsigned d = 0; d != PASSES; ++d) {
+            counts[d * RADIX + ((bits >> (d * Bits)) & MASK)]++;
+        }
+    }
+    scratch<T> tmp(n);
+    T *from = p;
+    T *to = tmp.data;
+    for (unsigned d = 0; d != PASSES; ++d) {
+        size_t *count = counts.data() + d * RADIX;
+        bits_type first = (bits_of(from[0]) >> (d * Bits)) & MASK;
+        if (count[first] == n) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t b = 0; b != RADIX; ++b) {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i != n; ++i) {
+            to[count[(bits_of(from[i]) >> (d * Bits)) & MASK]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != p) {
+        std::memcpy(static_cast<void *>(p), from, n * sizeof(T));
+    }
+}
+
+struct identity_key {
+  template<typename K>
+  K operator()(K key) const noexcept {
+      return key;
+  }
+};
+
+} // namespace radix_detail
+
+// ascending, NaNs with the sign bit set go first, the others last; strong
+template<unsigned Bits = 8, typename T>
+void radix_sort(vector<T> &v) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected, pass a key otherwise");
+    if (v.size() < 2) {
+        return;
+    }
+    radix_detail::lsd_sort<Bits>(v.data(), v.size(), radix_detail::identity_key());
+}
+
+// stable in the order of key(element), key must return an arithmetic type; basic
+template<unsigned Bits = 8, typename T, typename Key>
+void radix_sort(vector<T> &v, Key key) {
+    if (v.size() < 2) {
+        return;
+    }
+    radix_detail::lsd_sort<Bits>(v.data(), v.size(), key);
+}
+
+#endif //SUPER_VECTOR__RADIX_SORT_HPP_
@@ -0,0 +1,220 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__SERIALIZATION_HPP_
+#define SUPER_VECTOR__SERIALIZATION_HPP_
+
+#include <algorithm>
+#include <cerrno>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include "vector.hpp"
+#include "vector_format.hpp"
+#include "vector_simd.hpp"
+
+#ifdef SUPER_VECTOR_POSIX
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+// Binary serialization of vectors of trivially copyable elements. The data range is
+// contiguous, so writing is the header plus one write of the whole range, and reading
+// is one read into a buffer from resize_for_overwrite. The count in the header is not
+// trusted: a regular file must be long enough for it before the buffer is allocated,
+// other sources are read in chunks, so the buffer grows with the data actually read.
+// Layout in vector_format.hpp.
+namespace serialization_detail {
+
+template<typename T>
+vector_format::file_header header_for(vector<T> const &v, bool checksum) {
+    static_assert(std::is_trivially_copyable<T>::value, "trivially copyable elements expected");
+    vector_format::file_header h = vector_format::make_header(sizeof(T), v.size());
+    if (checksum) {
+        h.flags |= vector_format::HAS_CHECKSUM;
+        h.checksum = vector_simd::hash_bytes(v.data(), v.size() * sizeof(T), 0);
+    }
+    return h;
+}
+
+template<typename T>
+void check_data(vector_format::file_header const &h, vector<T> const &v) {
+    if ((h.flags & vector_format::HAS_CHECKSUM)
+        && vector_simd::hash_bytes(v.data(), v.size() * sizeof(T), 0) != h.checksum) {
+        throw std::runtime_error("vector checksum mismatch");
+    }
+}
+
+// bytes per read when the length of the source is unknown
+constexpr size_t READ_CHUNK = size_t(1) << 20;
+
+// appends count elements, read(dst, bytes) fills one chunk at a time
+template<typename T, typename Read>
+void read_chunked(vector<T> &result, uint64_t count, Read read) {
+    size_t chunk = std::max<size_t>(1, READ_CHUNK / sizeof(T));
+    while (result.size() != count) {
+        size_t have = result.size();
+        size_t part = static_cast<size_t>(std::min<uint64_t>(count - have, chunk));
+        if (have + part > result.capacity()) {
+            result.reserve(static_cast<size_t>(
+                std::min<uint64_t>(count, std::max(have + part, 2 * result.capacity()))));
+        }
+        result.resize_for_overwrite(have + part);
+        read(result.data() + have, part * sizeof(T));
+    }
+}
+
+#ifdef SUPER_VECTOR_POSIX
+// reads exactly n bytes, retrying short reads
+inline void read_fd(int fd, void *buf, size_t n) {
+    auto p = static_cast<char *>(buf);
+    while (n != 0) {
+        ssize_t got = ::read(fd, p, n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (got == 0) {
+            throw std::runtime_error("unexpected end of file");
+        }
+        p += got;
+        n -= got;
+    }
+}
+
+// writes exactly n bytes, retrying short writes
+inline void write_fd(int fd, void const *buf, size_t n) {
+    auto p = static_cast<char const *>(buf);
+    while (n != 0) {
+        ssize_t done = ::write(fd, p, n);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done < 0) {
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        p += done;
+        n -= done;
+    }
+}
+
+// bytes left after the current position of fd, or false if fd is not a regular file
+inline bool bytes_left(int fd, uint64_t &left) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    off_t pos = ::lseek(fd, 0, SEEK_CUR);
+    if (pos < 0) {
+        return false;
+    }
+    left = pos < st.st_size ? static_cast<uint64_t>(st.st_size - pos) : 0;
+    return true;
+}
+
+inline void skip_fd(int fd, uint64_t n) {
+    char buf[256];
+    while (n != 0) {
+        size_t part = n < sizeof(buf) ? n : sizeof(buf);
+        read_fd(fd, buf, part);
+        n -= part;
+    }
+}
+#endif
+
+} // namespace serialization_detail
+
+// one header write and one data write, checksum adds a hash of the data
+template<typename T>
+void serialize(vector<T> const &v, std::ostream &out, bool checksum = false) {
+    vector_format::file_header h = serialization_detail::header_for(v, checksum);
+    out.write(reinterpret_cast<char const *>(&h), sizeof(h));
+    out.write(reinterpret_cast<char const *>(v.data()), v.size() * sizeof(T));
+    if (!out) {
+        throw std::runtime_error("failed to write vector");
+    }
+}
+
+// strong, throws std::runtime_error on a foreign or corrupted stream
+template<typename T>
+vector<T> deserialize(std::istream &in) {
+    vector_format::file_header h;
+    if (!in.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+        throw std::runtime_error("failed to read vector header");
+    }
+    vector_format::check_header(h, sizeof(T));
+    in.ignore(h.data_offset - sizeof(h));
+    vector<T> result;
+    serialization_detail::read_chunked(result, h.count, [&in](T *dst, size_t bytes) {
+        if (!in.read(reinterpret_cast<char *>(dst), bytes)) {
+            throw std::runtime_error("failed to read vector data");
+        }
+    });
+    serialization_detail::check_data(h, result);
+    return result;
+}
+
+#ifdef SUPER_VECTOR_POSIX
+// the header and the data go out in one writev, partial writes are resumed
+template<typename T>
+void serialize(vector<T> const &v, int fd, bool checksum = false) {
+    vector_format::file_header h = serialization_detail::header_for(v, checksum);
+    iovec parts[2];
+    parts[0].iov_base = &h;
+    parts[0].iov_len = sizeof(h);
+    parts[1].iov_base = const_cast<T *>(v.data());
+    parts[1].iov_len = v.size() * sizeof(T);
+    iovec *first = parts;
+    int count = 2;
+    while (count != 0) {
+        ssize_t done = ::writev(fd, first, count);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done < 0) {
+            throw std::system_error(errno, std::generic_category(), "writev");
+        }
+        for (; count != 0 && static_cast<size_t>(done) >= first->iov_len; ++first, --count) {
+            done -= first->iov_len;
+        }
+        if (count != 0) {
+            first->iov_base = static_cast<char *>(first->iov_base) + done;
+            first->iov_len -= done;
+        }
+    }
+}
+
+// strong, see deserialize(std::istream &)
+template<typename T>
+vector<T> deserialize(int fd) {
+    vector_format::file_header h;
+    serialization_detail::read_fd(fd, &h, sizeof(h));
+    vector_format::check_header(h, sizeof(T));
+    uint64_t left;
+    bool bounded = serialization_detail::bytes_left(fd, left);
+    uint64_t gap = h.data_offset - sizeof(h);
+    if (bounded && (gap > left || h.count > (left - gap) / sizeof(T))) {
+        throw std::runtime_error("vector is longer than the file");
+    }
+    serialization_detail::skip_fd(fd, gap);
+    vector<T> result;
+    if (bounded) {
+        result.resize_for_overwrite(h.count);
+        serialization_detail::read_fd(fd, result.data(), h.count * sizeof(T));
+    } else {
+        serialization_detail::read_chunked(result, h.count, [fd](T *dst, size_t bytes) {
+            serialization_detail::read_fd(fd, dst, bytes);
+        });
+    }
+    serialization_detail::check_data(h, result);
+    return result;
+}
+#endif
+
+#endif //SUPER_VECTOR__SERIALIZATION_HPP_
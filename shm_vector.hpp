@@ -0,0 +1,259 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__SHM_VECTOR_HPP_
+#define SUPER_VECTOR__SHM_VECTOR_HPP_
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "vector.hpp"
+
+// Read-only vector in shared memory, attached by several processes without copying.
+// The region is one header page followed by the elements. The header holds only
+// offsets and counts, never pointers, since every process maps the region at its own
+// address, and an atomic reference counter of the handles in all processes. The
+// elements are written once by create() and mapped read-only everywhere. A region is
+// named (shm_open) or anonymous (memfd_create, pass fd() to the other process).
+template<typename T>
+class shm_vector {
+  static_assert(std::is_trivially_copyable<T>::value, "trivially copyable value_type expected");
+
+  struct header {
+    char magic[8];
+    uint64_t element_size;
+    uint64_t count;
+    uint64_t data_offset;
+    std::atomic<uint64_t> refs;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free, "cross-process atomics need lock-free");
+
+  public:
+  typedef T const *const_iterator;
+
+  // copies v into a new region, named if name is not null
+  static shm_vector create(vector<T> const &v, char const *name = nullptr) {
+      int fd;
+      if (name != nullptr) {
+          fd = ::shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+      } else {
+#ifdef MFD_CLOEXEC
+          fd = ::memfd_create("shm_vector", MFD_CLOEXEC);
+#else
+          throw std::runtime_error("anonymous shared memory is not supported, pass a name");
+#endif
+      }
+      if (fd < 0) {
+          throw std::system_error(errno, std::generic_category(), "shm_vector::create");
+      }
+      shm_vector result;
+      result.fd_ = fd;
+      if (name != nullptr) {
+          result.name_ = name;
+      }
+      size_t offset = page_();
+      size_t length = offset + v.size() * sizeof(T);
+      if (::ftruncate(fd, length) != 0) {
+          int err = errno;
+          result.unlink_();
+          throw std::system_error(err, std::generic_category(), "ftruncate");
+      }
+      try {
+          result.map_(length);
+      } catch (...) {
+          result.unlink_();
+          throw;
+      }
+      header *h = new(result.base_) header;
+      h->element_size = sizeof(T);
+      h->count = v.size();
+      h->data_offset = offset;
+      h->refs.store(1);
+      if (v.size() != 0) {
+          std::memcpy(result.base_ + offset, v.data(), v.size() * sizeof(T));
+      }
+      // the magic goes last, attach ignores a region that is still being filled
+      std::atomic_thread_fence(std::memory_order_release);
+      std::memcpy(h->magic, MAGIC_, sizeof(MAGIC_));
+      result.protect_();
+      return result;
+  }
+
+  // attaches to a region created in another process, fd is duplicated
+  static shm_vector attach(int fd) {
+      int own = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+      if (own < 0) {
+          throw std::system_error(errno, std::generic_category(), "shm_vector::attach");
+      }
+      return attach_fd_(own);
+  }
+
+  static shm_vector attach(char const *name) {
+      int fd = ::shm_open(name, O_RDWR, 0);
+      if (fd < 0) {
+          throw std::system_error(errno, std::generic_category(), name);
+      }
+      shm_vector result = attach_fd_(fd);
+      result.name_ = name;
+      return result;
+  }
+
+  shm_vector(shm_vector const &) = delete;
+  shm_vector &operator=(shm_vector const &) = delete;
+
+  shm_vector(shm_vector &&other) noexcept {
+      swap(other);
+  }
+
+  shm_vector &operator=(shm_vector &&other) noexcept {
+      shm_vector(std::move(other)).swap(*this);
+      return *this;
+  }
+
+  // the last handle in any process removes the name
+  ~shm_vector() {
+      if (base_ != nullptr && header_()->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          unlink_();
+      }
+      if (base_ != nullptr) {
+          ::munmap(base_, length_);
+      }
+      if (fd_ >= 0) {
+          ::close(fd_);
+      }
+  }
+
+  void swap(shm_vector &other) noexcept {
+      std::swap(fd_, other.fd_);
+      std::swap(base_, other.base_);
+      std::swap(length_, other.length_);
+      name_.swap(other.name_);
+  }
+
+  // descriptor to hand to another process, valid while this handle lives
+  int fd() const noexcept {
+      return fd_;
+  }
+
+  // handles attached in all processes
+  size_t use_count() const noexcept {
+      return header_()->refs.load(std::memory_order_relaxed);
+  }
+
+  size_t size() const noexcept {
+      return header_()->count;
+  }
+
+  bool empty() const noexcept {
+      return size() == 0;
+  }
+
+  T const *data() const noexcept {
+      return reinterpret_cast<T const *>(base_ + header_()->data_offset);
+  }
+
+  T const &operator[](size_t i) const noexcept {
+      return data()[i];
+  }
+
+  const_iterator begin() const noexcept {
+      return data();
+  }
+
+  const_iterator end() const noexcept {
+      return data() + size();
+  }
+
+  // a private heap copy of the elements
+  vector<T> to_vector() const {
+      return empty() ? vector<T>() : vector<T>(begin(), end());
+  }
+
+  private:
+  static constexpr char MAGIC_[8] = {'S', 'H', 'M', 'V', 'E', 'C', '1', '\0'};
+
+  int fd_ = -1;
+  char *base_ = nullptr;
+  size_t length_ = 0;
+  std::string name_;
+
+  shm_vector() = default;
+
+  static size_t page_() noexcept {
+      return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  }
+
+  header *header_() const noexcept {
+      return reinterpret_cast<header *>(base_);
+  }
+
+  void map_(size_t length) {
+      void *p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+      if (p == MAP_FAILED) {
+          throw std::system_error(errno, std::generic_category(), "mmap");
+      }
+      base_ = static_cast<char *>(p);
+      length_ = length;
+  }
+
+  // the header page stays writable for the counter, the elements become read-only
+  void protect_() {
+      size_t offset = header_()->data_offset;
+      if (length_ > offset && ::mprotect(base_ + offset, length_ - offset, PROT_READ) != 0) {
+          throw std::system_error(errno, std::generic_category(), "mprotect");
+      }
+  }
+
+  void unlink_() noexcept {
+      if (!name_.empty()) {
+          ::shm_unlink(name_.c_str());
+      }
+  }
+
+  static shm_vector attach_fd_(int fd) {
+      shm_vector result;
+      result.fd_ = fd;
+      struct stat st;
+      if (::fstat(fd, &st) != 0) {
+          throw std::system_error(errno, std::generic_category(), "fstat");
+      }
+      size_t length = st.st_size;
+      if (length < page_()) {
+          throw std::runtime_error("not a shared vector");
+      }
+      result.map_(length);
+      header *h = result.header_();
+      if (std::memcmp(h->magic, MAGIC_, sizeof(MAGIC_)) != 0 || h->element_size != sizeof(T)
+          || sizeof(header) > h->data_offset || h->data_offset > length
+          || h->count > (length - h->data_offset) / sizeof(T)) {
+          ::munmap(result.base_, result.length_);
+          result.base_ = nullptr;
+          throw std::runtime_error("not a shared vector of this type");
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // the last owner may be leaving right now, joining a region at zero is not allowed
+      uint64_t refs = h->refs.load();
+      do {
+          if (refs == 0) {
+              ::munmap(result.base_, result.length_);
+              result.base_ = nullptr;
+              throw std::runtime_error("shared vector was released");
+          }
+      } while (!h->refs.compare_exchange_weak(refs, refs + 1));
+      result.protect_();
+      return result;
+  }
+};
+
+#endif //SUPER_VECTOR__SHM_VECTOR_HPP_
@@ -6,9 +6,25 @@
 #define SUPER_VECTOR__VECTOR_HPP_
 
 #include <variant>
+#include <cstddef>
+#include <cstring>
 #include <iterator>
+#include <algorithm>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <functional>
+#include <stdexcept>
+#include <utility>
 #include <assert.h>
+#include "vector_simd.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SUPER_VECTOR_POSIX
+#endif
+
+template<typename E>
+struct vector_expr;
 
 template<typename T>
 struct vector_iterator {
@@ -17,6 +33,10 @@ struct vector_iterator {
   typedef std::ptrdiff_t difference_type;
   typedef T *pointer;
   typedef std::random_access_iterator_tag iterator_category;
+#if __cplusplus > 201703L
+  typedef std::contiguous_iterator_tag iterator_concept;
+  typedef T element_type;
+#endif
 
   template<typename> friend
   class vector;
@@ -32,7 +52,7 @@ struct vector_iterator {
       return *this;
   }
 
-  const vector_iterator operator++(int) {
+  vector_iterator operator++(int) {
       vector_iterator result(*this);
       ++*this;
       return result;
@@ -43,7 +63,7 @@ struct vector_iterator {
       return *this;
   }
 
-  const vector_iterator operator--(int) {
+  vector_iterator operator--(int) {
       vector_iterator result(*this);
       --*this;
       return result;
@@ -65,33 +85,33 @@ struct vector_iterator {
       return ptr_ != other.ptr_;
   }
 
-  bool operator<(vector_iterator const &other) {
+  bool operator<(vector_iterator const &other) const {
       return ptr_ < other.ptr_;
   }
 
-  bool operator>(vector_iterator const &other) {
+  bool operator>(vector_iterator const &other) const {
       return ptr_ > other.ptr_;
   }
 
-  bool operator<=(vector_iterator const &other) {
+  bool operator<=(vector_iterator const &other) const {
       return ptr_ <= other.ptr_;
   }
 
-  bool operator>=(vector_iterator const &other) {
+  bool operator>=(vector_iterator const &other) const {
       return ptr_ >= other.ptr_;
   }
 
-  vector_iterator &operator+=(size_t n) {
+  vector_iterator &operator+=(difference_type n) {
       ptr_ += n;
       return *this;
   }
 
-  vector_iterator &operator-=(size_t n) {
+  vector_iterator &operator-=(difference_type n) {
       ptr_ -= n;
       return *this;
   }
 
-  reference operator[](size_t n) {
+  reference operator[](difference_type n) const {
       return ptr_[n];
   }
 
@@ -99,17 +119,17 @@ struct vector_iterator {
       return p.ptr_ - q.ptr_;
   }
 
-  friend vector_iterator operator+(vector_iterator p, size_t n) {
+  friend vector_iterator operator+(vector_iterator p, difference_type n) {
       p += n;
       return p;
   }
 
-  friend vector_iterator operator-(vector_iterator p, size_t n) {
+  friend vector_iterator operator-(vector_iterator p, difference_type n) {
       p -= n;
       return p;
   }
 
-  friend vector_iterator operator+(size_t n, vector_iterator const &p) {
+  friend vector_iterator operator+(difference_type n, vector_iterator p) {
       p += n;
       return p;
   }
@@ -127,6 +147,10 @@ struct vector_const_iterator {
   typedef std::ptrdiff_t difference_type;
   typedef T const* pointer;
   typedef std::random_access_iterator_tag iterator_category;
+#if __cplusplus > 201703L
+  typedef std::contiguous_iterator_tag iterator_concept;
+  typedef T const element_type;
+#endif
 
 
   template<typename> friend
@@ -143,7 +167,7 @@ struct vector_const_iterator {
       return *this;
   }
 
-  const vector_const_iterator operator++(int) {
+  vector_const_iterator operator++(int) {
       vector_const_iterator result(*this);
       ++*this;
       return result;
@@ -154,7 +178,7 @@ struct vector_const_iterator {
       return *this;
   }
 
-  const vector_const_iterator operator--(int) {
+  vector_const_iterator operator--(int) {
       vector_const_iterator result(*this);
       --*this;
       return result;
@@ -176,33 +200,33 @@ struct vector_const_iterator {
       return ptr_ != other.ptr_;
   }
 
-  bool operator<(vector_const_iterator const &other) {
+  bool operator<(vector_const_iterator const &other) const {
       return ptr_ < other.ptr_;
   }
 
-  bool operator>(vector_const_iterator const &other) {
+  bool operator>(vector_const_iterator const &other) const {
       return ptr_ > other.ptr_;
   }
 
-  bool operator<=(vector_const_iterator const &other) {
+  bool operator<=(vector_const_iterator const &other) const {
       return ptr_ <= other.ptr_;
   }
 
-  bool operator>=(vector_const_iterator const &other) {
+  bool operator>=(vector_const_iterator const &other) const {
       return ptr_ >= other.ptr_;
   }
 
-  vector_const_iterator &operator+=(size_t n) {
+  vector_const_iterator &operator+=(difference_type n) {
       ptr_ += n;
       return *this;
   }
 
-  vector_const_iterator &operator-=(size_t n) {
+  vector_const_iterator &operator-=(difference_type n) {
       ptr_ -= n;
       return *this;
   }
 
-  reference operator[](size_t n) {
+  reference operator[](difference_type n) const {
       return ptr_[n];
   }
 
@@ -211,17 +235,17 @@ struct vector_const_iterator {
       return p.ptr_ - q.ptr_;
   }
 
-  friend vector_const_iterator operator+(vector_const_iterator p, size_t n) {
+  friend vector_const_iterator operator+(vector_const_iterator p, difference_type n) {
       p += n;
       return p;
   }
 
-  friend vector_const_iterator operator-(vector_const_iterator p, size_t n) {
+  friend vector_const_iterator operator-(vector_const_iterator p, difference_type n) {
       p -= n;
       return p;
   }
 
-  friend vector_const_iterator operator+(size_t n, vector_const_iterator const &p) {
+  friend vector_const_iterator operator+(difference_type n, vector_const_iterator p) {
       p += n;
       return p;
   }
@@ -244,11 +268,42 @@ class vector {
   typedef vector_const_iterator<T> const_iterator;
   typedef std::reverse_iterator<iterator> reverse_iterator;
   typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  static constexpr size_t npos = size_t(-1);
   private:
   typedef char *mix_ptr;
   typedef char const *const_mix_ptr;
   typedef size_t size_type;
   static const size_type DEFAULT_CAPACITY_ = 2;
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+  // reference counter is updated atomically and sits on its own cache line, so copies
+  // made by other threads do not invalidate the line holding size and capacity
+  static constexpr size_type CACHE_LINE_ = 64;
+  static constexpr size_type REF_OFFSET_ = CACHE_LINE_;
+  static constexpr size_type HASH_OFFSET_ = 2 * sizeof(size_type);
+  static constexpr size_type HEADER_SIZE_ = 2 * CACHE_LINE_;
+#else
+  static constexpr size_type REF_OFFSET_ = 2 * sizeof(size_type);
+  static constexpr size_type HASH_OFFSET_ = 3 * sizeof(size_type);
+#ifdef SUPER_VECTOR_CACHED_HASH
+  static constexpr size_type HEADER_SIZE_ = 4 * sizeof(size_type);
+#else
+  static constexpr size_type HEADER_SIZE_ = 3 * sizeof(size_type);
+#endif
+#endif
+
+  // set in the reference counter of a block that lives in a file mapping; such a block
+  // is never unique, so every write detaches, and the last owner unmaps it
+  static constexpr size_type FOREIGN_ = size_type(1) << (sizeof(size_type) * 8 - 1);
+
+  // stored right before the header of a mapped block, release unmaps the file
+  struct mapping_ {
+    void *base;
+    size_t length;
+    void (*release)(void *, size_t) noexcept;
+  };
+
+  template<typename U>
+  friend vector<U> map_file(char const *path);
 
   std::variant<mix_ptr, value_type> variant_;
   static_assert(sizeof(variant_) <= sizeof(void *) + std::max(sizeof(T), sizeof(void *)));
@@ -257,16 +312,23 @@ class vector {
   // service function
 
   mix_ptr allocate(size_type n) {
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+      return reinterpret_cast<mix_ptr>(operator new(n, std::align_val_t(CACHE_LINE_)));
+#else
       return reinterpret_cast<mix_ptr>(operator new(n));
+#endif
   }
 
   mix_ptr allocate_from_size_with_header(size_type n) {
-      return reinterpret_cast<mix_ptr>(operator new(
-          3 * sizeof(size_type) + n * sizeof(value_type)));
+      return allocate(HEADER_SIZE_ + n * sizeof(value_type));
   }
 
   void free_empty_memory(mix_ptr ptr) {
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+      operator delete(static_cast<void *>(ptr), std::align_val_t(CACHE_LINE_));
+#else
       operator delete(static_cast<void *>(ptr));
+#endif
   }
 
   size_type &vec_size_(mix_ptr ptr) noexcept {
@@ -286,19 +348,56 @@ class vector {
   }
 
   size_type &vec_ref_(mix_ptr ptr) noexcept {
-      return *reinterpret_cast<size_type *>(ptr + 2 * sizeof(size_type));
+      return *reinterpret_cast<size_type *>(ptr + REF_OFFSET_);
   }
 
   size_type const &vec_ref_(mix_ptr ptr) const noexcept {
-      return *reinterpret_cast<size_type *>(ptr + 2 * sizeof(size_type));
+      return *reinterpret_cast<size_type *>(ptr + REF_OFFSET_);
+  }
+
+  // 0 - hash is not computed; only present with SUPER_VECTOR_CACHED_HASH
+  size_type &vec_hash_(mix_ptr ptr) const noexcept {
+      return *reinterpret_cast<size_type *>(ptr + HASH_OFFSET_);
+  }
+
+  // every write to a unique block goes through here
+  void invalidate_hash_() noexcept {
+#ifdef SUPER_VECTOR_CACHED_HASH
+      __atomic_store_n(&vec_hash_(get_mix_ptr_()), 0, __ATOMIC_RELAXED);
+#endif
+  }
+
+  static void inc_ref_(size_type &ref) noexcept {
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+      __atomic_add_fetch(&ref, 1, __ATOMIC_RELAXED);
+#else
+      ++ref;
+#endif
+  }
+
+  // returns the new value
+  static size_type dec_ref_(size_type &ref) noexcept {
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+      return __atomic_sub_fetch(&ref, 1, __ATOMIC_ACQ_REL);
+#else
+      return --ref;
+#endif
+  }
+
+  static size_type load_ref_(size_type const &ref) noexcept {
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+      return __atomic_load_n(&ref, __ATOMIC_ACQUIRE);
+#else
+      return ref;
+#endif
   }
 
   pointer vec_data_(mix_ptr ptr) noexcept {
-      return reinterpret_cast<pointer>(ptr + 3 * sizeof(size_type));
+      return reinterpret_cast<pointer>(ptr + HEADER_SIZE_);
   }
 
   pointer vec_data_(mix_ptr ptr) const noexcept {
-      return reinterpret_cast<pointer>(ptr + 3 * sizeof(size_type));
+      return reinterpret_cast<pointer>(ptr + HEADER_SIZE_);
   }
 
   // noexcept if only if value_type destruction nothrow
@@ -322,10 +421,12 @@ class vector {
       new(ptr) value_type(value);
   }
 
+  // strong, destroys what was constructed if a copy throws
   void construct(pointer first, pointer last, const_reference value) {
-      while (first != last) {
-          construct(first, value);
-          ++first;
+      if constexpr (std::is_trivially_copyable<value_type>::value) {
+          vector_simd::fill(first, last - first, value);
+      } else {
+          std::uninitialized_fill(first, last, value);
       }
   }
 
@@ -407,7 +508,7 @@ class vector {
   }
 
   bool is_unique() const noexcept {
-      return ref_cnt_() == 1;
+      return load_ref_(ref_cnt_()) == 1;
   }
 
   bool is_empty() const noexcept {
@@ -421,9 +522,13 @@ class vector {
   }
 
   void cut_link_(mix_ptr ptr) noexcept {
-      if (--vec_ref_(ptr) == 0) {
+      size_type left = dec_ref_(vec_ref_(ptr));
+      if (left == 0) {
           destruct(vec_data_(ptr), vec_size_(ptr)); // noexcept
           free_empty_memory(ptr); // noexcept
+      } else if (left == FOREIGN_) {
+          mapping_ const &m = *reinterpret_cast<mapping_ const *>(ptr - sizeof(mapping_));
+          m.release(m.base, m.length); // noexcept
       }
   }
 
@@ -437,6 +542,9 @@ class vector {
       vec_size_(ptr) = sz;
       vec_cap_(ptr) = cp;
       vec_ref_(ptr) = ref;
+#ifdef SUPER_VECTOR_CACHED_HASH
+      vec_hash_(ptr) = 0;
+#endif
   }
 
   pointer get_unique_data() {
@@ -462,11 +570,9 @@ class vector {
       mix_ptr alloc_mem = nullptr;
       try {
           alloc_mem = allocate_from_size_with_header(vec_cap_(src_ptr));
-          std::uninitialized_copy(&vec_size_(src_ptr),
-                                  &vec_size_(src_ptr) + 3, &vec_size_(alloc_mem));
+          set_header_(alloc_mem, vec_size_(src_ptr), vec_cap_(src_ptr));
           std::uninitialized_copy(vec_data_(src_ptr), vec_data_(src_ptr) + vec_size_(src_ptr),
                                   vec_data_(alloc_mem));
-          vec_ref_(alloc_mem) = 1; // attention
           return alloc_mem;
       } catch (...) {
           free_empty_memory(alloc_mem);
@@ -479,12 +585,24 @@ class vector {
       mix_ptr alloc_mem = nullptr;
       try {
           alloc_mem = allocate_from_size_with_header(new_cap);
-          std::uninitialized_copy(&vec_size_(src_ptr),
-                                  &vec_size_(src_ptr) + 3, &vec_size_(alloc_mem));
+          set_header_(alloc_mem, vec_size_(src_ptr), new_cap);
           std::uninitialized_copy(vec_data_(src_ptr), vec_data_(src_ptr) + vec_size_(src_ptr),
                                   vec_data_(alloc_mem));
-          vec_cap_(alloc_mem) = new_cap; // attention
-          vec_ref_(alloc_mem) = 1; // attention
+          return alloc_mem;
+      } catch (...) {
+          free_empty_memory(alloc_mem);
+          throw;
+      }
+  }
+
+  // strong, big obj only, copies first count elements
+  mix_ptr copy_from_(mix_ptr src_ptr, size_type new_cap, size_type count) {
+      mix_ptr alloc_mem = nullptr;
+      try {
+          alloc_mem = allocate_from_size_with_header(new_cap);
+          set_header_(alloc_mem, count, new_cap);
+          std::uninitialized_copy(vec_data_(src_ptr), vec_data_(src_ptr) + count,
+                                  vec_data_(alloc_mem));
           return alloc_mem;
       } catch (...) {
           free_empty_memory(alloc_mem);
@@ -495,11 +613,11 @@ class vector {
   // strong, safety copy for big obj only
   void make_copy_if_not_unique() {
       if (is_unique()) {
+          invalidate_hash_();
           return;
       }
       mix_ptr new_mem = copy_from_(get_mix_ptr_());
       cut_link_(get_mix_ptr_());
-      set_header_(new_mem, size_(), capacity_());
       variant_ = new_mem;
   }
 
@@ -532,7 +650,6 @@ class vector {
   void shrink_() {
       mix_ptr new_mem = copy_from_(get_mix_ptr_(), size_());
       cut_link_(get_mix_ptr_());
-      set_header_(new_mem, size_(), size_());
       variant_ = new_mem;
   }
 
@@ -546,6 +663,20 @@ class vector {
       }
   }
 
+  size_t compute_hash_() const {
+      const_pointer p = get_unique_const_data();
+      if constexpr (std::has_unique_object_representations<value_type>::value) {
+          return vector_simd::hash_bytes(p, size() * sizeof(value_type), size());
+      } else {
+          size_t result = size();
+          std::hash<value_type> hasher;
+          for (size_type i = 0; i != size(); ++i) {
+              result ^= hasher(p[i]) + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+          }
+          return result;
+      }
+  }
+
   // strong
   void push_back_with_allocate(const_reference elem) {
       mix_ptr ptr = nullptr;
@@ -581,6 +712,9 @@ class vector {
   // strong
   void push_back_in_place(const_reference elem) {
       bool one = is_unique();
+      if (one) {
+          invalidate_hash_();
+      }
       mix_ptr ptr = one ? get_mix_ptr_() : copy_from_(get_mix_ptr_());
       try {
           construct(vec_data_(ptr) + vec_size_(ptr), elem);
@@ -618,12 +752,44 @@ class vector {
           }
       } else {
           variant_ = other.variant_; // noexcept
-          ++ref_cnt_(); // noexcept
+          inc_ref_(ref_cnt_()); // noexcept
       }
   }
 
+  // strong, see vector_expr.hpp
+  template<typename E>
+  vector(vector_expr<E> const &expr) {
+      *this = expr;
+  }
+
   // strong
-  template<typename InputIterator>
+  vector(size_type n, const_reference value) {
+      if (n == 0) {
+          return;
+      }
+      if (n == 1) {
+          try {
+              variant_ = value;
+          } catch (...) {
+              set_null();
+              throw;
+          }
+          return;
+      }
+      mix_ptr new_mem = allocate_from_size_with_header(n);
+      try {
+          construct(vec_data_(new_mem), vec_data_(new_mem) + n, value);
+      } catch (...) {
+          free_empty_memory(new_mem);
+          throw;
+      }
+      set_header_(new_mem, n, n);
+      variant_ = new_mem;
+  }
+
+  // strong
+  template<typename InputIterator,
+      typename = typename std::iterator_traits<InputIterator>::iterator_category>
   vector(InputIterator first, InputIterator last) {
       if (first + 1 == last) {
           try {
@@ -656,7 +822,7 @@ class vector {
               try {
                   variant_ = other.variant_;
                   if (!other.is_small()) {
-                      ++ref_cnt_();
+                      inc_ref_(ref_cnt_());
                   }
               } catch (...) {
                   set_null();
@@ -670,7 +836,7 @@ class vector {
           try {
               variant_ = other.variant_;
               if (!other.is_small()) {
-                  ++ref_cnt_();
+                  inc_ref_(ref_cnt_());
               }
           } catch (...) {
               variant_ = old;
@@ -681,6 +847,34 @@ class vector {
       return *this;
   }
 
+  // strong, evaluates the expression in one pass straight into our buffer; it is
+  // reused if unique and large enough, otherwise the result is built in a fresh one
+  // so that operands aliasing *this stay valid during evaluation. Slots past size()
+  // are assigned without being constructed, hence arithmetic value_type only.
+  template<typename E>
+  vector &operator=(vector_expr<E> const &expr) {
+      static_assert(std::is_arithmetic<value_type>::value, "arithmetic value_type expected");
+      E const &e = static_cast<E const &>(expr);
+      size_type n = e.size();
+      if (!is_small() && is_unique() && n <= capacity_()) {
+          invalidate_hash_();
+          pointer out = data_();
+          for (size_type i = 0; i != n; ++i) {
+              out[i] = e[i];
+          }
+          size_() = n;
+      } else {
+          vector result;
+          result.resize_for_overwrite(n);
+          pointer out = result.get_unique_data();
+          for (size_type i = 0; i != n; ++i) {
+              out[i] = e[i];
+          }
+          swap(result);
+      }
+      return *this;
+  }
+
   // basic, value_type depended
   template<typename InputIterator>
   vector assign(InputIterator first, InputIterator last) {
@@ -814,6 +1008,92 @@ class vector {
       return real_capacity_();
   }
 
+  // searches read the const data, a shared buffer stays shared
+  size_type find(const_reference value) const {
+      size_type ind = vector_simd::find(get_unique_const_data(), size(), value);
+      return ind == size() ? npos : ind;
+  }
+
+  size_type find_first_of(const_pointer values, size_type count) const {
+      size_type ind = vector_simd::find_any(get_unique_const_data(), size(), values, count);
+      return ind == size() ? npos : ind;
+  }
+
+  size_type find_first_of(vector const &values) const {
+      return find_first_of(values.data(), values.size());
+  }
+
+  size_type count(const_reference value) const {
+      return vector_simd::count(get_unique_const_data(), size(), value);
+  }
+
+  bool contains(const_reference value) const {
+      return find(value) != npos;
+  }
+
+  // bulk hash of the bytes for types with unique object representations, combined
+  // std::hash of elements otherwise; with SUPER_VECTOR_CACHED_HASH the result is kept
+  // in the shared header until the next write
+  size_t hash_code() const {
+#ifdef SUPER_VECTOR_CACHED_HASH
+      if (!is_small()) {
+          size_type &cached = vec_hash_(const_cast<mix_ptr>(get_mix_ptr_()));
+          size_type result = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+          if (result == 0) {
+              result = compute_hash_();
+              result += result == 0;
+              __atomic_store_n(&cached, result, __ATOMIC_RELAXED);
+          }
+          return result;
+      }
+#endif
+      return compute_hash_();
+  }
+
+  // 0 for an empty vector without storage, 1 for an unshared one
+  size_type use_count() const noexcept {
+      if (variant_.index() == 1) {
+          return 1;
+      }
+      return get_mix_ptr_() == nullptr ? 0 : load_ref_(ref_cnt_()) & ~FOREIGN_;
+  }
+
+  // the elements are read from a file mapping, see mapped_vector.hpp
+  bool is_mapped() const noexcept {
+      return !is_small() && (load_ref_(ref_cnt_()) & FOREIGN_) != 0;
+  }
+
+  bool is_shared() const noexcept {
+      return use_count() > 1;
+  }
+
+  // strong, detaches from other owners so the next write does not copy
+  void unshare() {
+      if (!is_small()) {
+          make_copy_if_not_unique();
+      }
+  }
+
+  // O(1) frozen copy sharing the storage, the first write to either side detaches.
+  // Without SUPER_VECTOR_SHARED_REFCOUNT the count is not atomic: another thread may
+  // read the snapshot, but it must be copied and destroyed on the owner's thread.
+  vector snapshot() const {
+      return *this;
+  }
+
+  // strong, detaches and grows to at least new_cap in a single allocation
+  void reserve_unique(size_type new_cap) {
+      if (is_small()) {
+          if (new_cap > 1) {
+              extend_(new_cap);
+          }
+      } else if (!is_unique() || new_cap > capacity_()) {
+          extend_(std::max(new_cap, capacity_()));
+      } else {
+          invalidate_hash_();
+      }
+  }
+
   // strong
   void shrink_to_fit() {
       if (size() < capacity()) {
@@ -841,6 +1121,7 @@ class vector {
       }
       if (new_size == 0) {
           clear();
+          return;
       }
       if (is_small() && empty()) {
           if (new_size == 1) {
@@ -855,7 +1136,7 @@ class vector {
               try {
                   ptr = allocate_from_size_with_header(new_size);
                   set_header_(ptr, new_size, new_size);
-                  std::uninitialized_fill(vec_data_(ptr), vec_data_(ptr) + new_size, value_type());
+                  construct(vec_data_(ptr), vec_data_(ptr) + new_size, value_type());
               } catch (...) {
                   free_empty_memory(ptr);
                   throw;
@@ -865,20 +1146,61 @@ class vector {
           return;
       }
       if (new_size < size()) {
-          make_copy_if_not_unique();
-          destruct(data() + new_size, data() + size());
-      } else {
-          mix_ptr ptr = copy_from_(get_mix_ptr_(), std::max(new_size, capacity()));
-          try {
-              std::uninitialized_fill(vec_data_(ptr) + size(),
-                                      vec_data_(ptr) + new_size, value_type());
-          } catch (...) {
-              free_with_destruct(ptr);
-              throw;
+          if (is_unique()) {
+              invalidate_hash_();
+              destruct(data_() + new_size, data_() + size_());
+          } else {
+              mix_ptr new_mem = copy_from_(get_mix_ptr_(), capacity_(), new_size);
+              cut_link_(get_mix_ptr_());
+              variant_ = new_mem;
           }
-          clear();
-          variant_ = ptr;
-          set_header_(new_size, std::max(new_size, capacity()));
+          size_() = new_size;
+      } else {
+          reserve_unique(new_size);
+          construct(data_() + size_(), data_() + new_size, value_type());
+          size_() = new_size;
+      }
+  }
+
+  // strong, trivial value_type only, new elements are left uninitialized
+  void resize_for_overwrite(size_type new_size) {
+      static_assert(std::is_trivially_default_constructible<value_type>::value
+                        && std::is_trivially_destructible<value_type>::value,
+                    "trivial value_type expected");
+      if (is_small() && new_size <= 1) {
+          resize(new_size);
+          return;
+      }
+      reserve_unique(new_size);
+      size_() = new_size;
+  }
+
+  // strong if value_type is trivially copyable, basic otherwise;
+  // a shared buffer is replaced, not copied and then overwritten
+  void fill(const_reference value) {
+      if (!is_small() && !is_unique()) {
+          vector(size(), value).swap(*this);
+          return;
+      }
+      pointer p = get_unique_data();
+      if constexpr (std::is_trivially_copyable<value_type>::value) {
+          vector_simd::fill(p, size(), value);
+      } else {
+          std::fill(p, p + size(), value);
+      }
+  }
+
+  // element i becomes start + i; strong
+  void iota(value_type start) {
+      static_assert(std::is_arithmetic<value_type>::value, "numeric vector expected");
+      if (!is_small() && !is_unique()) {
+          vector fresh;
+          fresh.resize_for_overwrite(size());
+          swap(fresh);
+      }
+      pointer p = get_unique_data();
+      for (size_type i = 0, n = size(); i != n; ++i) {
+          p[i] = static_cast<value_type>(start + static_cast<value_type>(i));
       }
   }
 
@@ -892,32 +1214,34 @@ class vector {
 
   // basic, strong if "end insert"
   iterator insert(const_iterator pos, const_reference elem) {
-      if (pos == end()) {
+      size_type ind = pos - cbegin();
+      if (ind == size()) {
           push_back(elem);
           return end() - 1;
       }
       if (is_small()) {
-          if (pos != begin()) {
+          if (ind != 0) {
               throw std::runtime_error("invalid iterator");
           }
           vector<value_type> buf;
-          buf.push_back(*begin());
           buf.push_back(elem);
+          buf.push_back(val_());
           swap(buf);
           return begin();
       } else {
           value_type insert_elem(elem);
-          mix_ptr new_mem =
-              allocate_from_size_with_header(size() < capacity() ? capacity() : capacity() * 2);
+          size_type new_cap = size() < capacity() ? capacity() : capacity() * 2;
+          mix_ptr new_mem = allocate_from_size_with_header(new_cap);
+          pointer old_data_ptr = data_();
           pointer new_data_ptr = vec_data_(new_mem);
           try {
-              std::uninitialized_copy(begin(), begin() + (pos - begin()), new_data_ptr);
-              set_header_(new_mem, pos - begin(), capacity() * 2);
+              std::uninitialized_copy(old_data_ptr, old_data_ptr + ind, new_data_ptr);
+              set_header_(new_mem, ind, new_cap);
           } catch (...) {
               free_empty_memory(new_mem);
               throw;
           }
-          new_data_ptr += pos - begin();
+          new_data_ptr += ind;
           iterator ret_iter = iterator(new_data_ptr);
           try {
               construct(new_data_ptr, insert_elem);
@@ -928,8 +1252,8 @@ class vector {
               throw;
           }
           try {
-              std::uninitialized_copy(begin() + (pos - begin()), end(), new_data_ptr);
-              vec_size_(new_mem) += end() - pos;
+              std::uninitialized_copy(old_data_ptr + ind, old_data_ptr + size_(), new_data_ptr);
+              vec_size_(new_mem) += size_() - ind;
           } catch (...) {
               free_with_destruct(new_mem);
               throw;
@@ -947,25 +1271,23 @@ class vector {
 
   // basic, strong if "end erase"
   iterator erase(const_iterator first, const_iterator last) {
+      typename const_iterator::difference_type sz_begin = first - cbegin();
+      typename const_iterator::difference_type sz_erase = last - first;
+      typename const_iterator::difference_type sz_end = cend() - last;
       if (first == last) {
-          return begin() + (first - begin());
+          return begin() + sz_begin;
       }
       if (is_small()) {
-          if (first != last) {
-              pop_back();
-          }
+          pop_back();
           return begin();
       }
       make_copy_if_not_unique();
-      if (last == end()) {
-          destruct(first.ptr_, last.ptr_);
-          size_() -= last - first;
+      if (sz_end == 0) {
+          destruct(data_() + sz_begin, data_() + size_());
+          size_() = sz_begin;
           return end();
       }
-      typename const_iterator::difference_type sz_begin = first - begin();
-      typename const_iterator::difference_type sz_erase = last - first;
-      typename const_iterator::difference_type sz_end = end() - last;
-      pointer ptr_begin = data();
+      pointer ptr_begin = data_();
       pointer ptr_erase = ptr_begin + sz_begin;
       pointer ptr_end = ptr_erase + sz_erase;
       if (sz_erase >= sz_end) {
@@ -1042,9 +1364,21 @@ class vector {
 
 };
 
+// vectors sharing one COW block are equal without looking at the data
 template<typename T>
 bool operator==(vector<T> const &a, vector<T> const &b) {
-    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    if (a.size() != b.size()) {
+        return false;
+    }
+    if (a.data() == b.data()) {
+        return true;
+    }
+    if constexpr (vector_simd::is_bitwise_comparable<T>::value) {
+        size_t bytes = a.size() * sizeof(T);
+        return vector_simd::first_mismatch(a.data(), b.data(), bytes) == bytes;
+    } else {
+        return std::equal(a.data(), a.data() + a.size(), b.data());
+    }
 }
 
 template<typename T>
@@ -1054,7 +1388,21 @@ bool operator!=(vector<T> const &a, vector<T> const &b) {
 
 template<typename T>
 bool operator<(vector<T> const &a, vector<T> const &b) {
-    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+    if constexpr (vector_simd::is_bitwise_comparable<T>::value && sizeof(T) > 1) {
+        size_t common = std::min(a.size(), b.size());
+        size_t ind = a.data() == b.data() ? common
+            : vector_simd::first_mismatch(a.data(), b.data(), common * sizeof(T)) / sizeof(T);
+        return ind == common ? a.size() < b.size() : a.data()[ind] < b.data()[ind];
+    } else if constexpr (std::is_same<T, unsigned char>::value || std::is_same<T, std::byte>::value
+                         || (std::is_same<T, char>::value && !std::is_signed<char>::value)) {
+        // memcmp orders unsigned bytes like <, signed ones go element by element below
+        size_t common = std::min(a.size(), b.size());
+        int order = common == 0 ? 0 : std::memcmp(a.data(), b.data(), common);
+        return order == 0 ? a.size() < b.size() : order < 0;
+    } else {
+        return std::lexicographical_compare(a.data(), a.data() + a.size(),
+                                            b.data(), b.data() + b.size());
+    }
 }
 
 template<typename T>
@@ -1077,4 +1425,71 @@ void swap(vector<T> &a, vector<T> &b) {
     a.swap(b);
 }
 
+// removes the elements satisfying pred, detaches once; returns the number removed; basic
+template<typename T, typename Predicate>
+size_t erase_if(vector<T> &v, Predicate pred) {
+    size_t n = v.size();
+    if (n == 0) {
+        return 0;
+    }
+    T *p = v.data();
+    size_t kept;
+    if constexpr (vector_simd::is_compressible<T>::value) {
+        kept = vector_simd::compress(p, n, [p, n, &pred](size_t i) {
+            uint64_t mask = 0;
+            size_t block = std::min<size_t>(64, n - i);
+            for (size_t j = 0; j != block; ++j) {
+                mask |= uint64_t(!pred(p[i + j])) << j;
+            }
+            return mask;
+        });
+    } else {
+        kept = std::remove_if(p, p + n, pred) - p;
+    }
+    v.erase(std::as_const(v).begin() + kept, std::as_const(v).end());
+    return n - kept;
+}
+
+// keeps the elements whose bit in keep is set, bit i of the mask is bit i % 64 of
+// keep[i / 64]; returns the number removed; basic
+template<typename T>
+size_t compact(vector<T> &v, vector<uint64_t> const &keep) {
+    size_t n = v.size();
+    if (keep.size() < (n + 63) / 64) {
+        throw std::runtime_error("mask is shorter than vector");
+    }
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t const *words = keep.data();
+    T *p = v.data();
+    size_t kept;
+    if constexpr (vector_simd::is_compressible<T>::value) {
+        kept = vector_simd::compress(p, n, [words](size_t i) {
+            return words[i / 64];
+        });
+    } else {
+        kept = 0;
+        for (size_t i = 0; i != n; ++i) {
+            if (words[i / 64] >> (i % 64) & 1) {
+                if (kept != i) {
+                    p[kept] = std::move(p[i]);
+                }
+                ++kept;
+            }
+        }
+    }
+    v.erase(std::as_const(v).begin() + kept, std::as_const(v).end());
+    return n - kept;
+}
+
+namespace std {
+template<typename T>
+struct hash<::vector<T>> {
+  size_t operator()(::vector<T> const &v) const {
+      return v.hash_code();
+  }
+};
+}
+
 #endif //SUPER_VECTOR__VECTOR_HPP_
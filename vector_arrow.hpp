@@ -0,0 +1,230 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__VECTOR_ARROW_HPP_
+#define SUPER_VECTOR__VECTOR_ARROW_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "vector.hpp"
+
+// Zero-copy exchange of numeric vectors through the Apache Arrow C data interface.
+// to_arrow hands the consumer the vector's own buffer and keeps it alive with a shared
+// copy of the vector, released by the release callback. from_arrow wraps a foreign
+// primitive array read-only and calls its release callback when the view goes away.
+// Without SUPER_VECTOR_SHARED_REFCOUNT the count is not atomic, so an exported array
+// must be released on a thread that does not use the vector at the same time.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace arrow_detail {
+
+template<typename T>
+constexpr char const *format() noexcept {
+    if constexpr (std::is_same<T, int8_t>::value) {
+        return "c";
+    } else if constexpr (std::is_same<T, uint8_t>::value) {
+        return "C";
+    } else if constexpr (std::is_same<T, int16_t>::value) {
+        return "s";
+    } else if constexpr (std::is_same<T, uint16_t>::value) {
+        return "S";
+    } else if constexpr (std::is_same<T, int32_t>::value) {
+        return "i";
+    } else if constexpr (std::is_same<T, uint32_t>::value) {
+        return "I";
+    } else if constexpr (std::is_same<T, int64_t>::value) {
+        return "l";
+    } else if constexpr (std::is_same<T, uint64_t>::value) {
+        return "L";
+    } else if constexpr (std::is_same<T, float>::value) {
+        return "f";
+    } else if constexpr (std::is_same<T, double>::value) {
+        return "g";
+    } else {
+        return nullptr;
+    }
+}
+
+// owned by an exported array: the copy holds a reference to the block, so the data
+// pointer stays valid however the original vector changes
+template<typename T>
+struct exported {
+  vector<T> owner;
+  const void *buffers[2];
+};
+
+template<typename T>
+void release_array(ArrowArray *array) noexcept {
+    delete static_cast<exported<T> *>(array->private_data);
+    array->release = nullptr;
+}
+
+inline void release_schema(ArrowSchema *schema) noexcept {
+    schema->release = nullptr;
+}
+
+} // namespace arrow_detail
+
+// strong, fills both structs for a primitive array without nulls, no element is copied
+template<typename T>
+void to_arrow(vector<T> const &v, ArrowArray *array, ArrowSchema *schema) {
+    static_assert(arrow_detail::format<T>() != nullptr, "arithmetic value_type of a fixed width expected");
+    auto *state = new arrow_detail::exported<T>{v, {nullptr, nullptr}};
+    state->buffers[1] = std::as_const(state->owner).data();
+
+    array->length = static_cast<int64_t>(v.size());
+    array->null_count = 0;
+    array->offset = 0;
+    array->n_buffers = 2;
+    array->n_children = 0;
+    array->buffers = state->buffers;
+    array->children = nullptr;
+    array->dictionary = nullptr;
+    array->release = &arrow_detail::release_array<T>;
+    array->private_data = state;
+
+    schema->format = arrow_detail::format<T>();
+    schema->name = "";
+    schema->metadata = nullptr;
+    schema->flags = 0;
+    schema->n_children = 0;
+    schema->children = nullptr;
+    schema->dictionary = nullptr;
+    schema->release = &arrow_detail::release_schema;
+    schema->private_data = nullptr;
+}
+
+// Read-only elements of a foreign Arrow array. The view owns the array and releases it.
+template<typename T>
+class arrow_view {
+  public:
+  typedef T value_type;
+  typedef T const *const_iterator;
+
+  arrow_view(arrow_view const &) = delete;
+  arrow_view &operator=(arrow_view const &) = delete;
+
+  arrow_view(arrow_view &&other) noexcept : array_(other.array_) {
+      other.array_.release = nullptr;
+  }
+
+  arrow_view &operator=(arrow_view &&other) noexcept {
+      if (this != &other) {
+          release_();
+          array_ = other.array_;
+          other.array_.release = nullptr;
+      }
+      return *this;
+  }
+
+  ~arrow_view() {
+      release_();
+  }
+
+  size_t size() const noexcept {
+      return static_cast<size_t>(array_.length);
+  }
+
+  bool empty() const noexcept {
+      return size() == 0;
+  }
+
+  T const *data() const noexcept {
+      return static_cast<T const *>(array_.buffers[1]) + array_.offset;
+  }
+
+  T const &operator[](size_t i) const noexcept {
+      return data()[i];
+  }
+
+  const_iterator begin() const noexcept {
+      return data();
+  }
+
+  const_iterator end() const noexcept {
+      return data() + size();
+  }
+
+  // a private copy of the elements
+  vector<T> to_vector() const {
+      return empty() ? vector<T>() : vector<T>(begin(), end());
+  }
+
+  private:
+  ArrowArray array_;
+
+  explicit arrow_view(ArrowArray *array) noexcept : array_(*array) {
+      array->release = nullptr;
+  }
+
+  void release_() noexcept {
+      if (array_.release != nullptr) {
+          array_.release(&array_);
+      }
+  }
+
+  template<typename U>
+  friend arrow_view<U> from_arrow(ArrowArray *, ArrowSchema const *);
+};
+
+// Moves the array into the view. Throws std::runtime_error, leaving the array to the
+// caller, if it is not a primitive array of T without nulls.
+template<typename T>
+arrow_view<T> from_arrow(ArrowArray *array, ArrowSchema const *schema) {
+    static_assert(arrow_detail::format<T>() != nullptr, "arithmetic value_type of a fixed width expected");
+    if (array->release == nullptr || schema->format == nullptr) {
+        throw std::runtime_error("released arrow array");
+    }
+    if (std::strcmp(schema->format, arrow_detail::format<T>()) != 0) {
+        throw std::runtime_error("arrow format does not match the value_type");
+    }
+    if (array->n_buffers != 2 || array->n_children != 0 || array->length < 0 || array->offset < 0) {
+        throw std::runtime_error("primitive arrow array expected");
+    }
+    // -1 is an unknown null count, it may hide nulls as well
+    if (array->null_count != 0) {
+        throw std::runtime_error("arrow array with nulls is not supported");
+    }
+    if (array->length != 0 && array->buffers[1] == nullptr) {
+        throw std::runtime_error("arrow array without a data buffer");
+    }
+    return arrow_view<T>(array);
+}
+
+#endif //SUPER_VECTOR__VECTOR_ARROW_HPP_
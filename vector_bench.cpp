@@ -0,0 +1,239 @@
+// Opt-in benchmarks, configure with -DSUPER_VECTOR_BENCH=ON.
+// Usage: vector_bench [name...], without names every benchmark except the huge ones runs.
+#include "vector.hpp"
+#include "checkpoint.hpp"
+#include "compressed_vector.hpp"
+#include "concurrent_vector.hpp"
+#include "paged_vector.hpp"
+#include "parallel_sort.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// 1, 2, 4, ... up to the number of cores, and the number of cores itself
+vector<unsigned> thread_counts() {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    vector<unsigned> result;
+    for (unsigned t = 1; t < cores; t *= 2) {
+        result.push_back(t);
+    }
+    result.push_back(cores);
+    return result;
+}
+
+template<typename F>
+double run_threads(unsigned threads, F f) {
+    std::vector<std::thread> pool;
+    bench_clock::time_point start = bench_clock::now();
+    for (unsigned t = 0; t != threads; ++t) {
+        pool.emplace_back(f, t);
+    }
+    for (std::thread &t : pool) {
+        t.join();
+    }
+    return seconds_since(start);
+}
+
+// contended push_back: every thread appends its share of the same total
+void concurrent_push_back() {
+    constexpr size_t TOTAL = size_t(1) << 23;
+    std::printf("concurrent_push_back, %zu elements\n", TOTAL);
+    std::printf("%8s %18s %18s\n", "threads", "concurrent Mops/s", "mutex Mops/s");
+    for (unsigned threads : thread_counts()) {
+        size_t share = TOTAL / threads;
+        concurrent_vector<uint64_t> cv;
+        double lock_free = run_threads(threads, [&](unsigned t) {
+            for (size_t i = 0; i != share; ++i) {
+                cv.push_back(t * share + i);
+            }
+        });
+        vector<uint64_t> v;
+        std::mutex m;
+        double locked = run_threads(threads, [&](unsigned t) {
+            for (size_t i = 0; i != share; ++i) {
+                std::lock_guard<std::mutex> lock(m);
+                v.push_back(t * share + i);
+            }
+        });
+        std::printf("%8u %18.1f %18.1f\n", threads,
+                    share * threads / lock_free / 1e6, share * threads / locked / 1e6);
+    }
+}
+
+vector<uint64_t> random_keys(size_t n) {
+    vector<uint64_t> v;
+    v.resize_for_overwrite(n);
+    uint64_t *p = v.data();
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i != n; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        p[i] = x;
+    }
+    return v;
+}
+
+// thread counts above the pool size are clamped by parallel_sort, the table shows the
+// number actually used
+void sort_sizes(std::initializer_list<size_t> sizes) {
+    size_t pool = parallel_detail::task_pool::instance().concurrency();
+    std::printf("parallel_sort of random uint64_t, pool of %zu threads\n", pool);
+    std::printf("%12s %8s %12s %12s\n", "elements", "threads", "seconds", "std::sort");
+    for (size_t n : sizes) {
+        vector<uint64_t> keys = random_keys(n);
+        vector<uint64_t> serial = keys;
+        bench_clock::time_point start = bench_clock::now();
+        std::sort(serial.data(), serial.data() + n);
+        double baseline = seconds_since(start);
+        size_t last = 0;
+        for (size_t threads : {1, 4, 16, 64}) {
+            size_t used = std::min(threads, pool);
+            if (used == last) {
+                continue;
+            }
+            last = used;
+            vector<uint64_t> v = keys;
+            v.unshare();
+            start = bench_clock::now();
+            parallel_sort(v, std::less<uint64_t>(), used);
+            std::printf("%12zu %8zu %12.3f %12.3f\n", n, used, seconds_since(start), baseline);
+        }
+    }
+}
+
+void parallel_sort_bench() {
+    sort_sizes({1000000, 10000000, 100000000});
+}
+
+// 10^9 keys, needs 16 GB for the keys and the merge buffer
+void parallel_sort_huge() {
+    sort_sizes({1000000000});
+}
+
+// time per element must stay flat as the size grows, building is linear
+void compressed_build() {
+    std::printf("compressed_vector<uint32_t> build, ns per element\n");
+    std::printf("%12s %14s %14s\n", "elements", "constructor", "push_back");
+    for (size_t n = size_t(1) << 17; n <= size_t(1) << 23; n *= 2) {
+        vector<uint32_t> v;
+        v.resize_for_overwrite(n);
+        uint32_t *p = v.data();
+        for (size_t i = 0; i != n; ++i) {
+            p[i] = static_cast<uint32_t>(i * 2654435761u);
+        }
+        bench_clock::time_point start = bench_clock::now();
+        compressed_vector<uint32_t> built(v);
+        double constructor = seconds_since(start);
+        start = bench_clock::now();
+        compressed_vector<uint32_t> appended;
+        for (size_t i = 0; i != n; ++i) {
+            appended.push_back(p[i]);
+        }
+        double push_back = seconds_since(start);
+        std::printf("%12zu %14.2f %14.2f\n", n, constructor / n * 1e9, push_back / n * 1e9);
+    }
+}
+
+// one random write after another, each timed on its own; with a checkpoint the writes go
+// on until it is done, at most max_writes of them
+template<typename C>
+std::vector<double> timed_writes(C &v, size_t max_writes, checkpoint<C> const *cp) {
+    std::vector<double> ns;
+    ns.reserve(max_writes);
+    uint64_t x = 88172645463325252ull;
+    while (ns.size() != max_writes && (cp == nullptr || !cp->done())) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        bench_clock::time_point start = bench_clock::now();
+        v[x % v.size()] = x;
+        ns.push_back(seconds_since(start) * 1e9);
+    }
+    return ns;
+}
+
+void print_latency(char const *name, char const *phase, std::vector<double> ns) {
+    std::sort(ns.begin(), ns.end());
+    std::printf("%-12s %-8s %10zu %10.0f %10.0f %12.1f\n", name, phase, ns.size(),
+                ns[ns.size() / 2], ns[ns.size() * 99 / 100], ns.back() / 1e3);
+}
+
+template<typename C>
+void checkpoint_writes(char const *name, C &v, std::string const &path) {
+    constexpr size_t WRITES = size_t(1) << 22;
+    print_latency(name, "idle", timed_writes(v, WRITES, static_cast<checkpoint<C> const *>(nullptr)));
+    bench_clock::time_point start = bench_clock::now();
+    C snapshot = v.snapshot();
+    double snapshot_time = seconds_since(start);
+    snapshot = C();
+    start = bench_clock::now();
+    checkpoint<C> cp(v, path);
+    std::vector<double> ns = timed_writes(v, WRITES, &cp);
+    cp.wait();
+    double checkpoint_time = seconds_since(start);
+    print_latency(name, "during", std::move(ns));
+    std::printf("%-12s snapshot %.3f us, checkpoint %.3f s\n", name, snapshot_time * 1e6, checkpoint_time);
+}
+
+// writer latency while a checkpoint streams a snapshot to disk: the first write detaches
+// a vector with one copy of every element, a paged_vector copies the touched page only
+void checkpoint_latency() {
+    constexpr size_t N = size_t(1) << 24;
+    std::string path = "/tmp/super_vector_bench_checkpoint_" + std::to_string(getpid());
+    std::printf("checkpoint of %zu uint64_t, per-write latency of a random writer\n", N);
+    std::printf("%-12s %-8s %10s %10s %10s %12s\n", "container", "phase", "writes", "p50 ns",
+                "p99 ns", "max us");
+    vector<uint64_t> v = random_keys(N);
+    checkpoint_writes("vector", v, path);
+    v = vector<uint64_t>();
+    paged_vector<uint64_t> paged;
+    for (size_t i = 0; i != N; ++i) {
+        paged.push_back(i);
+    }
+    checkpoint_writes("paged_vector", paged, path);
+    ::unlink(path.c_str());
+}
+
+struct bench {
+  char const *name;
+  void (*run)();
+  bool by_name_only;
+};
+
+bench const BENCHES[] = {
+    {"concurrent_push_back", &concurrent_push_back, false},
+    {"checkpoint_latency", &checkpoint_latency, false},
+    {"compressed_build", &compressed_build, false},
+    {"parallel_sort", &parallel_sort_bench, false},
+    {"parallel_sort_huge", &parallel_sort_huge, true},
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    for (bench const &b : BENCHES) {
+        bool selected = argc == 1 && !b.by_name_only;
+        for (int i = 1; i != argc; ++i) {
+            selected |= std::strcmp(argv[i], b.name) == 0;
+        }
+        if (selected) {
+            b.run();
+        }
+    }
+}
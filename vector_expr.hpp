@@ -0,0 +1,170 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__VECTOR_EXPR_HPP_
+#define SUPER_VECTOR__VECTOR_EXPR_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include "vector.hpp"
+
+// Lazy elementwise arithmetic over numeric vectors. a * b + c builds a tree of
+// small expression objects and nothing is computed until the tree is assigned to a
+// vector, which evaluates every element in a single fused loop without temporaries.
+// Leaves keep the const data pointer of their vector, so operands are never detached.
+
+template<typename E>
+struct vector_expr {
+  E const &self() const noexcept {
+      return static_cast<E const &>(*this);
+  }
+};
+
+template<typename T>
+struct vector_leaf_expr : vector_expr<vector_leaf_expr<T>> {
+  typedef T value_type;
+  static constexpr bool is_scalar = false;
+
+  explicit vector_leaf_expr(vector<T> const &v) noexcept : data_(v.data()), size_(v.size()) {}
+
+  value_type operator[](size_t i) const noexcept {
+      return data_[i];
+  }
+
+  size_t size() const noexcept {
+      return size_;
+  }
+
+  private:
+  T const *data_;
+  size_t size_;
+};
+
+template<typename T>
+struct scalar_expr : vector_expr<scalar_expr<T>> {
+  typedef T value_type;
+  static constexpr bool is_scalar = true;
+
+  explicit scalar_expr(T value) noexcept : value_(value) {}
+
+  value_type operator[](size_t) const noexcept {
+      return value_;
+  }
+
+  size_t size() const noexcept {
+      return 0;
+  }
+
+  private:
+  T value_;
+};
+
+template<typename Op, typename L, typename R>
+struct binary_expr : vector_expr<binary_expr<Op, L, R>> {
+  typedef typename std::common_type<typename L::value_type,
+                                    typename R::value_type>::type value_type;
+  static constexpr bool is_scalar = false;
+
+  binary_expr(L const &l, R const &r) : l_(l), r_(r) {
+      if (!L::is_scalar && !R::is_scalar && l.size() != r.size()) {
+          throw std::runtime_error("size mismatch");
+      }
+  }
+
+  value_type operator[](size_t i) const noexcept {
+      return Op()(static_cast<value_type>(l_[i]), static_cast<value_type>(r_[i]));
+  }
+
+  size_t size() const noexcept {
+      return L::is_scalar ? r_.size() : l_.size();
+  }
+
+  private:
+  L l_;
+  R r_;
+};
+
+namespace expr_detail {
+
+template<typename X, typename = void>
+struct as_expr {};
+
+template<typename T>
+struct as_expr<vector<T>, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+  typedef vector_leaf_expr<T> type;
+  static constexpr bool is_operand = true;
+
+  static type wrap(vector<T> const &v) noexcept {
+      return type(v);
+  }
+};
+
+template<typename T>
+struct as_expr<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+  typedef scalar_expr<T> type;
+  static constexpr bool is_operand = false;
+
+  static type wrap(T value) noexcept {
+      return type(value);
+  }
+};
+
+template<typename E>
+struct as_expr<E, typename std::enable_if<std::is_base_of<vector_expr<E>, E>::value>::type> {
+  typedef E type;
+  static constexpr bool is_operand = true;
+
+  static E const &wrap(E const &e) noexcept {
+      return e;
+  }
+};
+
+template<typename X, typename = void>
+struct has_expr : std::false_type {};
+
+template<typename X>
+struct has_expr<X, typename std::enable_if<as_expr<X>::is_operand>::type> : std::true_type {};
+
+template<typename X, typename = void>
+struct is_expr_arg : std::false_type {};
+
+template<typename X>
+struct is_expr_arg<X, decltype(void(sizeof(typename as_expr<X>::type)))> : std::true_type {};
+
+// at least one side must be a vector or an expression, scalars alone stay scalars
+template<typename Op, typename A, typename B>
+using result_t = typename std::enable_if<
+    is_expr_arg<A>::value && is_expr_arg<B>::value && (has_expr<A>::value || has_expr<B>::value),
+    binary_expr<Op, typename as_expr<A>::type, typename as_expr<B>::type>>::type;
+
+template<typename Op, typename A, typename B>
+result_t<Op, A, B> make(A const &a, B const &b) {
+    return result_t<Op, A, B>(as_expr<A>::wrap(a), as_expr<B>::wrap(b));
+}
+
+} // namespace expr_detail
+
+template<typename A, typename B>
+expr_detail::result_t<std::plus<>, A, B> operator+(A const &a, B const &b) {
+    return expr_detail::make<std::plus<>>(a, b);
+}
+
+template<typename A, typename B>
+expr_detail::result_t<std::minus<>, A, B> operator-(A const &a, B const &b) {
+    return expr_detail::make<std::minus<>>(a, b);
+}
+
+template<typename A, typename B>
+expr_detail::result_t<std::multiplies<>, A, B> operator*(A const &a, B const &b) {
+    return expr_detail::make<std::multiplies<>>(a, b);
+}
+
+template<typename A, typename B>
+expr_detail::result_t<std::divides<>, A, B> operator/(A const &a, B const &b) {
+    return expr_detail::make<std::divides<>>(a, b);
+}
+
+#endif //SUPER_VECTOR__VECTOR_EXPR_HPP_
@@ -0,0 +1,81 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__VECTOR_FORMAT_HPP_
+#define SUPER_VECTOR__VECTOR_FORMAT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// On-disk layout of a serialized vector: a 256 byte header followed by the raw
+// elements. Data starts at data_offset, so a mapped file keeps the elements aligned
+// and there is room in front of them for an in-memory block header.
+namespace vector_format {
+
+constexpr char MAGIC[8] = {'S', 'V', 'E', 'C', 'T', 'O', 'R', '\0'};
+constexpr uint32_t VERSION = 1;
+// reads back as another value on a machine of the other byte order
+constexpr uint32_t ENDIANNESS_TAG = 0x01020304;
+constexpr uint64_t DATA_OFFSET = 256;
+// no less than the in-memory block header of any build, bounds count so that a block
+// of count elements fits in size_t
+constexpr uint64_t MAX_BLOCK_HEADER = 128;
+
+enum flags : uint32_t {
+  HAS_CHECKSUM = 1
+};
+
+struct file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t endianness;
+  uint32_t element_size;
+  uint32_t flags;
+  uint64_t count;
+  // vector_simd::hash_bytes of the data with seed 0, valid with HAS_CHECKSUM
+  uint64_t checksum;
+  uint64_t data_offset;
+  unsigned char reserved[DATA_OFFSET - 48];
+};
+
+static_assert(sizeof(file_header) == DATA_OFFSET, "header must fill the space before the data");
+
+inline file_header make_header(uint32_t element_size, uint64_t count) noexcept {
+    file_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.endianness = ENDIANNESS_TAG;
+    h.element_size = element_size;
+    h.count = count;
+    h.data_offset = DATA_OFFSET;
+    return h;
+}
+
+// throws if the header was not written by this format for elements of element_size
+inline void check_header(file_header const &h, uint32_t element_size) {
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("not a serialized vector");
+    }
+    if (h.version != VERSION) {
+        throw std::runtime_error("unsupported vector format version");
+    }
+    if (h.endianness != ENDIANNESS_TAG) {
+        throw std::runtime_error("vector was written with another byte order");
+    }
+    if (h.element_size != element_size) {
+        throw std::runtime_error("element size mismatch");
+    }
+    if (h.count > (SIZE_MAX - MAX_BLOCK_HEADER) / element_size) {
+        throw std::runtime_error("corrupted vector header");
+    }
+    if (h.data_offset < sizeof(file_header)) {
+        throw std::runtime_error("corrupted vector header");
+    }
+}
+
+} // namespace vector_format
+
+#endif //SUPER_VECTOR__VECTOR_FORMAT_HPP_
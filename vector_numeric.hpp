@@ -0,0 +1,332 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__VECTOR_NUMERIC_HPP_
+#define SUPER_VECTOR__VECTOR_NUMERIC_HPP_
+
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include "vector.hpp"
+#include "vector_simd.hpp"
+
+// Reductions over numeric vectors. Everything reads the const data, so shared
+// buffers stay shared. Kernels keep LANES_ independent accumulators, which lets the
+// compiler vectorize them without reassociating floating point sums; the same body
+// is instantiated for AVX-512, AVX2 and the default target and picked at run time.
+namespace numeric {
+
+enum class summation {
+  naive,
+  kahan,
+  pairwise
+};
+
+// integral sums are accumulated in 64 bits
+template<typename T>
+using accumulator_t = typename std::conditional<std::is_floating_point<T>::value, T,
+    typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>::type;
+
+namespace detail {
+
+template<typename T>
+using minmax_t = std::pair<T, T>;
+
+constexpr size_t LANES_ = 16;
+constexpr size_t PAIRWISE_BLOCK_ = 1024;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SUPER_VECTOR_ALWAYS_INLINE __attribute__((always_inline)) inline
+#else
+#define SUPER_VECTOR_ALWAYS_INLINE inline
+#endif
+
+template<typename T>
+SUPER_VECTOR_ALWAYS_INLINE accumulator_t<T> sum_kernel(T const *p, size_t n) {
+    typedef accumulator_t<T> acc_type;
+    acc_type acc[LANES_] = {};
+    size_t i = 0;
+    for (; i + LANES_ <= n; i += LANES_) {
+        for (size_t j = 0; j != LANES_; ++j) {
+            acc[j] += static_cast<acc_type>(p[i + j]);
+        }
+    }
+    acc_type result = 0;
+    for (size_t j = 0; j != LANES_; ++j) {
+        result += acc[j];
+    }
+    for (; i != n; ++i) {
+        result += static_cast<acc_type>(p[i]);
+    }
+    return result;
+}
+
+template<typename T>
+SUPER_VECTOR_ALWAYS_INLINE T kahan_kernel(T const *p, size_t n) {
+    T acc[LANES_] = {};
+    T comp[LANES_] = {};
+    size_t i = 0;
+    for (; i + LANES_ <= n; i += LANES_) {
+        for (size_t j = 0; j != LANES_; ++j) {
+            T y = p[i + j] - comp[j];
+            T t = acc[j] + y;
+            comp[j] = (t - acc[j]) - y;
+            acc[j] = t;
+        }
+    }
+    T result = 0;
+    T c = 0;
+    auto add = [&result, &c](T x) {
+        T y = x - c;
+        T t = result + y;
+        c = (t - result) - y;
+        result = t;
+    };
+    for (size_t j = 0; j != LANES_; ++j) {
+        add(acc[j]);
+        add(-comp[j]);
+    }
+    for (; i != n; ++i) {
+        add(p[i]);
+    }
+    return result;
+}
+
+template<typename T>
+SUPER_VECTOR_ALWAYS_INLINE accumulator_t<T> dot_kernel(T const *a, T const *b, size_t n) {
+    typedef accumulator_t<T> acc_type;
+    acc_type acc[LANES_] = {};
+    size_t i = 0;
+    for (; i + LANES_ <= n; i += LANES_) {
+        for (size_t j = 0; j != LANES_; ++j) {
+            acc[j] += static_cast<acc_type>(a[i + j]) * static_cast<acc_type>(b[i + j]);
+        }
+    }
+    acc_type result = 0;
+    for (size_t j = 0; j != LANES_; ++j) {
+        result += acc[j];
+    }
+    for (; i != n; ++i) {
+        result += static_cast<acc_type>(a[i]) * static_cast<acc_type>(b[i]);
+    }
+    return result;
+}
+
+// index of the first element that is not NaN, 0 if all of them are
+template<typename T>
+SUPER_VECTOR_ALWAYS_INLINE size_t first_ordered(T const *p, size_t n) {
+    size_t i = 0;
+    if constexpr (std::is_floating_point<T>::value) {
+        while (i != n && p[i] != p[i]) {
+            ++i;
+        }
+    }
+    return i == n ? 0 : i;
+}
+
+// n > 0, NaNs are skipped: a NaN never compares less or greater than the seed
+template<typename T>
+SUPER_VECTOR_ALWAYS_INLINE std::pair<T, T> minmax_kernel(T const *p, size_t n) {
+    size_t i = first_ordered(p, n);
+    T mn[LANES_];
+    T mx[LANES_];
+    for (size_t j = 0; j != LANES_; ++j) {
+        mn[j] = mx[j] = p[i];
+    }
+    for (; i + LANES_ <= n; i += LANES_) {
+        for (size_t j = 0; j != LANES_; ++j) {
+            mn[j] = p[i + j] < mn[j] ? p[i + j] : mn[j];
+            mx[j] = mx[j] < p[i + j] ? p[i + j] : mx[j];
+        }
+    }
+    for (; i != n; ++i) {
+        mn[0] = p[i] < mn[0] ? p[i] : mn[0];
+        mx[0] = mx[0] < p[i] ? p[i] : mx[0];
+    }
+    for (size_t j = 1; j != LANES_; ++j) {
+        mn[0] = mn[j] < mn[0] ? mn[j] : mn[0];
+        mx[0] = mx[0] < mx[j] ? mx[j] : mx[0];
+    }
+    return {mn[0], mx[0]};
+}
+
+// indices of the first minimal and the first maximal element, n > 0, NaNs are skipped
+template<typename T>
+SUPER_VECTOR_ALWAYS_INLINE std::pair<size_t, size_t> argminmax_kernel(T const *p, size_t n) {
+    size_t i = first_ordered(p, n);
+    T mn[LANES_];
+    T mx[LANES_];
+    size_t imn[LANES_];
+    size_t imx[LANES_];
+    for (size_t j = 0; j != LANES_; ++j) {
+        mn[j] = mx[j] = p[i];
+        imn[j] = imx[j] = i;
+    }
+    for (; i + LANES_ <= n; i += LANES_) {
+        for (size_t j = 0; j != LANES_; ++j) {
+            bool lower = p[i + j] < mn[j];
+            bool higher = mx[j] < p[i + j];
+            mn[j] = lower ? p[i + j] : mn[j];
+            imn[j] = lower ? i + j : imn[j];
+            mx[j] = higher ? p[i + j] : mx[j];
+            imx[j] = higher ? i + j : imx[j];
+        }
+    }
+    for (; i != n; ++i) {
+        if (p[i] < mn[0]) {
+            mn[0] = p[i];
+            imn[0] = i;
+        }
+        if (mx[0] < p[i]) {
+            mx[0] = p[i];
+            imx[0] = i;
+        }
+    }
+    // lanes hold the first extreme they saw, equal values resolve to the lower index
+    for (size_t j = 1; j != LANES_; ++j) {
+        if (mn[j] < mn[0] || (!(mn[0] < mn[j]) && imn[j] < imn[0])) {
+            mn[0] = mn[j];
+            imn[0] = imn[j];
+        }
+        if (mx[0] < mx[j] || (!(mx[j] < mx[0]) && imx[j] < imx[0])) {
+            mx[0] = mx[j];
+            imx[0] = imx[j];
+        }
+    }
+    return {imn[0], imx[0]};
+}
+
+#undef SUPER_VECTOR_ALWAYS_INLINE
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+#define SUPER_VECTOR_DISPATCH_(name, kernel, ret, params, args)                          \
+  template<typename T>                                                                    \
+  __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"))) ret name##_avx512 params { \
+      return kernel args;                                                                 \
+  }                                                                                       \
+  template<typename T>                                                                    \
+  __attribute__((target("avx2"))) ret name##_avx2 params {                                \
+      return kernel args;                                                                 \
+  }                                                                                       \
+  template<typename T>                                                                    \
+  ret name params {                                                                       \
+      if (vector_simd::has_avx512_dqvl()) {                                               \
+          return name##_avx512 args;                                                      \
+      }                                                                                   \
+      if (vector_simd::has_avx2()) {                                                      \
+          return name##_avx2 args;                                                        \
+      }                                                                                   \
+      return kernel args;                                                                 \
+  }
+#else
+#define SUPER_VECTOR_DISPATCH_(name, kernel, ret, params, args)                          \
+  template<typename T>                                                                    \
+  ret name params {                                                                       \
+      return kernel args;                                                                 \
+  }
+#endif
+
+SUPER_VECTOR_DISPATCH_(sum, sum_kernel, accumulator_t<T>, (T const *p, size_t n), (p, n))
+SUPER_VECTOR_DISPATCH_(kahan, kahan_kernel, T, (T const *p, size_t n), (p, n))
+SUPER_VECTOR_DISPATCH_(dot, dot_kernel, accumulator_t<T>,
+                       (T const *a, T const *b, size_t n), (a, b, n))
+SUPER_VECTOR_DISPATCH_(minmax, minmax_kernel, minmax_t<T>, (T const *p, size_t n), (p, n))
+SUPER_VECTOR_DISPATCH_(argminmax, argminmax_kernel, minmax_t<size_t>, (T const *p, size_t n), (p, n))
+
+#undef SUPER_VECTOR_DISPATCH_
+
+template<typename T>
+T pairwise(T const *p, size_t n) {
+    if (n <= PAIRWISE_BLOCK_) {
+        return sum(p, n);
+    }
+    size_t half = n / 2;
+    return pairwise(p, half) + pairwise(p + half, n - half);
+}
+
+} // namespace detail
+
+template<typename T>
+accumulator_t<T> sum(vector<T> const &v, summation mode = summation::naive) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected");
+    if constexpr (std::is_floating_point<T>::value) {
+        if (mode == summation::kahan) {
+            return detail::kahan(v.data(), v.size());
+        }
+        if (mode == summation::pairwise) {
+            return detail::pairwise(v.data(), v.size());
+        }
+    }
+    return detail::sum(v.data(), v.size());
+}
+
+template<typename T>
+accumulator_t<T> dot(vector<T> const &a, vector<T> const &b) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected");
+    if (a.size() != b.size()) {
+        throw std::runtime_error("size mismatch");
+    }
+    return detail::dot(a.data(), b.data(), a.size());
+}
+
+// NaNs are skipped, a vector of NaNs gives NaN
+template<typename T>
+std::pair<T, T> minmax(vector<T> const &v) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected");
+    if (v.size() == 0) {
+        throw std::runtime_error("empty vector");
+    }
+    return detail::minmax(v.data(), v.size());
+}
+
+// index of the first minimal element, vector<T>::npos if empty; NaNs are skipped,
+// a vector of NaNs gives 0
+template<typename T>
+size_t argmin(vector<T> const &v) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected");
+    return v.size() == 0 ? vector<T>::npos : detail::argminmax(v.data(), v.size()).first;
+}
+
+// index of the first maximal element, see argmin
+template<typename T>
+size_t argmax(vector<T> const &v) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected");
+    return v.size() == 0 ? vector<T>::npos : detail::argminmax(v.data(), v.size()).second;
+}
+
+// bins equal-width buckets over [lo, hi), values outside the range are skipped
+template<typename T>
+vector<size_t> histogram(vector<T> const &v, T lo, T hi, size_t bins) {
+    static_assert(std::is_arithmetic<T>::value, "numeric vector expected");
+    if (bins == 0 || !(lo < hi)) {
+        throw std::runtime_error("invalid histogram range");
+    }
+    // four interleaved tables, consecutive equal values do not serialize on one counter
+    constexpr size_t TABLES = 4;
+    vector<size_t> partial;
+    partial.resize(TABLES * bins);
+    size_t *counts = partial.data();
+    T const *p = v.data();
+    double scale = static_cast<double>(bins) / (static_cast<double>(hi) - static_cast<double>(lo));
+    for (size_t i = 0; i != v.size(); ++i) {
+        if (p[i] < lo || !(p[i] < hi)) {
+            continue;
+        }
+        size_t bin = static_cast<size_t>((static_cast<double>(p[i]) - static_cast<double>(lo)) * scale);
+        counts[(i % TABLES) * bins + std::min(bin, bins - 1)]++;
+    }
+    vector<size_t> result;
+    result.resize(bins);
+    size_t *out = result.data();
+    for (size_t t = 0; t != TABLES; ++t) {
+        for (size_t b = 0; b != bins; ++b) {
+            out[b] += counts[t * bins + b];
+        }
+    }
+    return result;
+}
+
+} // namespace numeric
+
+#endif //SUPER_VECTOR__VECTOR_NUMERIC_HPP_
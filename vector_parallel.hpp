@@ -0,0 +1,339 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__VECTOR_PARALLEL_HPP_
+#define SUPER_VECTOR__VECTOR_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "vector.hpp"
+
+// Parallel algorithms over the contiguous buffer. The vector is detached on the calling
+// thread before anything is dispatched, workers only see raw pointers, so the plain
+// refcount is never touched concurrently. A range is split in halves lazily: the running
+// thread pushes the right half to its own deque and keeps the left one, idle workers
+// steal the oldest, largest pieces from the other end. A waiting thread runs tasks too,
+// so nested calls do not block workers.
+namespace parallel_detail {
+
+class task_pool {
+  struct job {
+    std::atomic<size_t> pending{1};
+    std::atomic<bool> failed{false};
+    size_t grain;
+    std::exception_ptr error;
+    std::mutex m;
+  };
+
+  struct task {
+    void (*call)(void const *, size_t, size_t);
+    void const *fn;
+    size_t first;
+    size_t last;
+    job *owner;
+  };
+
+  struct alignas(64) task_deque {
+    std::mutex m;
+    std::deque<task> tasks;
+  };
+
+  public:
+  static task_pool &instance() {
+      static task_pool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+      return pool;
+  }
+
+  // the last deque is shared by threads outside the pool
+  explicit task_pool(size_t workers) : deques_(new task_deque[workers + 1]), count_(workers + 1) {
+      for (size_t i = 0; i != workers; ++i) {
+          workers_.emplace_back([this, i] { work_(i); });
+      }
+  }
+
+  task_pool(task_pool const &) = delete;
+  task_pool &operator=(task_pool const &) = delete;
+
+  ~task_pool() {
+      stop_ = true;
+      {
+          std::lock_guard<std::mutex> lg(sleep_m_);
+      }
+      sleep_cv_.notify_all();
+      for (std::thread &t : workers_) {
+          t.join();
+      }
+  }
+
+  // workers plus the calling thread
+  size_t concurrency() const noexcept {
+      return workers_.size() + 1;
+  }
+
+  // calls fn(first, last) on disjoint pieces of [0, n) of at most grain elements;
+  // rethrows the first exception after every started piece has finished
+  template<typename F>
+  void for_range(size_t n, size_t grain, F const &fn) {
+      if (n == 0) {
+          return;
+      }
+      job j;
+      j.grain = std::max<size_t>(grain, 1);
+      execute_(task{&invoke_<F>, &fn, 0, n, &j});
+      while (j.pending.load(std::memory_order_acquire) != 0) {
+          task t;
+          if (take_(t)) {
+              execute_(t);
+          } else {
+              std::this_thread::yield();
+          }
+      }
+      if (j.error) {
+          std::rethrow_exception(j.error);
+      }
+  }
+
+  // calls fn(i) for every i in [0, n) on at most threads threads, 0 means all of them
+  template<typename F>
+  void run(size_t n, F const &fn, size_t threads = 0) {
+      if (threads == 0 || threads > concurrency()) {
+          threads = concurrency();
+      }
+      std::atomic<size_t> next{0};
+      for_range(std::min(n, threads), 1, [&next, n, &fn](size_t, size_t) {
+          for (size_t i; (i = next.fetch_add(1)) < n;) {
+              try {
+                  fn(i);
+              } catch (...) {
+                  next = n;
+                  throw;
+              }
+          }
+      });
+  }
+
+  private:
+  std::unique_ptr<task_deque[]> deques_;
+  size_t count_;
+  std::vector<std::thread> workers_;
+  std::atomic<bool> stop_{false};
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> sleeping_{0};
+  std::mutex sleep_m_;
+  std::condition_variable sleep_cv_;
+
+  template<typename F>
+  static void invoke_(void const *fn, size_t first, size_t last) {
+      (*static_cast<F const *>(fn))(first, last);
+  }
+
+  // deque of the current thread
+  size_t own_() const noexcept {
+      std::pair<task_pool const *, size_t> const &self = current_();
+      return self.first == this ? self.second : count_ - 1;
+  }
+
+  static std::pair<task_pool const *, size_t> &current_() noexcept {
+      static thread_local std::pair<task_pool const *, size_t> self(nullptr, 0);
+      return self;
+  }
+
+  void push_(task const &t) {
+      task_deque &d = deques_[own_()];
+      {
+          std::lock_guard<std::mutex> lg(d.m);
+          d.tasks.push_back(t);
+      }
+      queued_.fetch_add(1);
+      if (sleeping_.load() != 0) {
+          std::lock_guard<std::mutex> lg(sleep_m_);
+          sleep_cv_.notify_one();
+      }
+  }
+
+  // newest task of the own deque, otherwise the oldest of another one
+  bool take_(task &t) {
+      size_t own = own_();
+      for (size_t k = 0; k != count_; ++k) {
+          task_deque &d = deques_[(own + k) % count_];
+          std::lock_guard<std::mutex> lg(d.m);
+          if (!d.tasks.empty()) {
+              if (k == 0) {
+                  t = d.tasks.back();
+                  d.tasks.pop_back();
+              } else {
+                  t = d.tasks.front();
+                  d.tasks.pop_front();
+              }
+              queued_.fetch_sub(1);
+              return true;
+          }
+      }
+      return false;
+  }
+
+  void execute_(task t) {
+      job &j = *t.owner;
+      while (t.last - t.first > j.grain) {
+          size_t mid = t.first + (t.last - t.first) / 2;
+          j.pending.fetch_add(1);
+          push_(task{t.call, t.fn, mid, t.last, t.owner});
+          t.last = mid;
+      }
+      if (!j.failed.load(std::memory_order_relaxed)) {
+          try {
+              t.call(t.fn, t.first, t.last);
+          } catch (...) {
+              std::lock_guard<std::mutex> lg(j.m);
+              if (!j.error) {
+                  j.error = std::current_exception();
+              }
+              j.failed = true;
+          }
+      }
+      // the owner may destroy the job right after this
+      j.pending.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  void work_(size_t index) {
+      current_() = {this, index};
+      while (!stop_) {
+          task t;
+          if (take_(t)) {
+              execute_(t);
+              continue;
+          }
+          std::unique_lock<std::mutex> ul(sleep_m_);
+          sleeping_.fetch_add(1);
+          sleep_cv_.wait(ul, [this] { return stop_ || queued_.load() != 0; });
+          sleeping_.fetch_sub(1);
+      }
+  }
+};
+
+// pieces of about 50us, measured on a serial probe over the first elements
+constexpr size_t PROBE_ = 256;
+constexpr double TARGET_NS_ = 50000;
+
+// processes [0, probe) on the calling thread with fn and returns {probe, grain} for the rest
+template<typename F>
+std::pair<size_t, size_t> tune_grain(size_t n, size_t grain, F const &fn) {
+    if (grain != 0) {
+        return {0, grain};
+    }
+    size_t probe = std::min(n, PROBE_);
+    auto start = std::chrono::steady_clock::now();
+    fn(0, probe);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double per_element = std::max(ns, 1.0) / std::max<size_t>(probe, 1);
+    size_t rest = n - probe;
+    // at least four pieces per thread, so stealing can even out the load
+    size_t most = std::max<size_t>(1, rest / (4 * task_pool::instance().concurrency()));
+    size_t tuned = static_cast<size_t>(TARGET_NS_ / per_element);
+    return {probe, std::min(std::max<size_t>(tuned, 1), most)};
+}
+
+} // namespace parallel_detail
+
+// calls f(element) for every element, grain 0 tunes the piece size; basic
+template<typename T, typename F>
+void parallel_for_each(vector<T> &v, F f, size_t grain = 0) {
+    size_t n = v.size();
+    if (n == 0) {
+        return;
+    }
+    T *p = v.data();
+    auto body = [p, &f](size_t first, size_t last) {
+        for (size_t i = first; i != last; ++i) {
+            f(p[i]);
+        }
+    };
+    std::pair<size_t, size_t> tuned = parallel_detail::tune_grain(n, grain, body);
+    T *rest = p + tuned.first;
+    parallel_detail::task_pool::instance().for_range(n - tuned.first, tuned.second,
+                                                     [rest, &f](size_t first, size_t last) {
+        for (size_t i = first; i != last; ++i) {
+            f(rest[i]);
+        }
+    });
+}
+
+// dst[i] = f(src[i]), dst gets the size of src and is detached once; basic
+template<typename T, typename U, typename F>
+void parallel_transform(vector<T> const &src, vector<U> &dst, F f, size_t grain = 0) {
+    size_t n = src.size();
+    // src may be dst
+    vector<T> keep = src;
+    if constexpr (std::is_trivially_default_constructible<U>::value
+        && std::is_trivially_destructible<U>::value) {
+        dst.resize_for_overwrite(n);
+    } else {
+        dst.resize(n);
+    }
+    if (n == 0) {
+        return;
+    }
+    T const *in = std::as_const(keep).data();
+    U *out = dst.data();
+    auto body = [in, out, &f](size_t first, size_t last) {
+        for (size_t i = first; i != last; ++i) {
+            out[i] = f(in[i]);
+        }
+    };
+    std::pair<size_t, size_t> tuned = parallel_detail::tune_grain(n, grain, body);
+    size_t offset = tuned.first;
+    parallel_detail::task_pool::instance().for_range(n - offset, tuned.second,
+                                                     [&body, offset](size_t first, size_t last) {
+        body(first + offset, last + offset);
+    });
+}
+
+// folds the elements with op starting from init, op must be associative and take U on
+// both sides; pieces are combined in index order, so the result does not depend on
+// scheduling; basic
+template<typename T, typename U, typename Op>
+U parallel_reduce(vector<T> const &v, U init, Op op, size_t grain = 0) {
+    size_t n = v.size();
+    if (n == 0) {
+        return init;
+    }
+    T const *p = v.data();
+    U head = init;
+    std::pair<size_t, size_t> tuned = parallel_detail::tune_grain(n, grain,
+                                                                  [p, &op, &head](size_t first, size_t last) {
+        for (size_t i = first; i != last; ++i) {
+            head = op(head, p[i]);
+        }
+    });
+    size_t offset = tuned.first;
+    size_t piece = tuned.second;
+    size_t pieces = (n - offset + piece - 1) / piece;
+    std::vector<std::unique_ptr<U>> partial(pieces);
+    parallel_detail::task_pool::instance().for_range(pieces, 1, [&](size_t first, size_t last) {
+        for (size_t k = first; k != last; ++k) {
+            size_t from = offset + k * piece;
+            size_t to = std::min(n, from + piece);
+            U acc = p[from];
+            for (size_t i = from + 1; i != to; ++i) {
+                acc = op(acc, p[i]);
+            }
+            partial[k].reset(new U(std::move(acc)));
+        }
+    });
+    for (std::unique_ptr<U> &part : partial) {
+        head = op(head, *part);
+    }
+    return head;
+}
+
+#endif //SUPER_VECTOR__VECTOR_PARALLEL_HPP_
@@ -0,0 +1,645 @@
+//
+// Created by taras on 18.06.19.
+//
+
+#ifndef SUPER_VECTOR__VECTOR_SIMD_HPP_
+#define SUPER_VECTOR__VECTOR_SIMD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <memory>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SUPER_VECTOR_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Bulk kernels over contiguous data used by vector and its extensions. Wide
+// variants are compiled with target attributes and chosen at run time, so the
+// rest of the project keeps the default -march.
+namespace vector_simd {
+
+// types whose equality is equality of their bytes
+template<typename T>
+struct is_bitwise_comparable : std::integral_constant<bool,
+    std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+// arithmetic types with a vectorized search kernel
+template<typename T>
+struct is_searchable : std::integral_constant<bool,
+    (std::is_integral<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4
+        || sizeof(T) == 8))
+        || std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+inline bool has_avx2() noexcept {
+    static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return result;
+}
+
+inline bool has_avx512() noexcept {
+    static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512bw"));
+    return result;
+}
+
+// has_avx512() plus the dq and vl extensions
+inline bool has_avx512_dqvl() noexcept {
+    static const bool result = (__builtin_cpu_init(), has_avx512() && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vl"));
+    return result;
+}
+
+inline bool has_avx512_popcount() noexcept {
+    static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512vpopcntdq"));
+    return result;
+}
+
+inline bool has_popcnt() noexcept {
+    static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("popcnt"));
+    return result;
+}
+#endif
+
+inline size_t first_mismatch_scalar(unsigned char const *a, unsigned char const *b,
+                                    size_t n) noexcept {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, sizeof(x));
+        std::memcpy(&y, b + i, sizeof(y));
+        if (x != y) {
+            break;
+        }
+    }
+    for (; i != n && a[i] == b[i]; ++i) {}
+    return i;
+}
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+__attribute__((target("avx2")))
+inline size_t first_mismatch_avx2(unsigned char const *a, unsigned char const *b,
+                                  size_t n) noexcept {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b + i));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + first_mismatch_scalar(a + i, b + i, n - i);
+}
+#endif
+
+// offset of the first differing byte, n if the ranges are equal
+inline size_t first_mismatch(void const *a, void const *b, size_t n) noexcept {
+    auto pa = static_cast<unsigned char const *>(a);
+    auto pb = static_cast<unsigned char const *>(b);
+#ifdef SUPER_VECTOR_X86_DISPATCH
+    if (has_avx2()) {
+        return first_mismatch_avx2(pa, pb, n);
+    }
+#endif
+    return first_mismatch_scalar(pa, pb, n);
+}
+
+// _____________________________________________________________________________________________
+// hash
+
+namespace hash_detail {
+
+inline uint64_t read8(unsigned char const *p) noexcept {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read4(unsigned char const *p) noexcept {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 64x64 -> 128 bit multiply folded to 64 bits
+inline uint64_t mum(uint64_t a, uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    uint128 r = static_cast<uint128>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    return lo ^ hi;
+#endif
+}
+
+constexpr uint64_t SECRET_[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+} // namespace hash_detail
+
+// wyhash-style hash, processes 48 bytes per round with three independent lanes
+inline uint64_t hash_bytes(void const *data, size_t n, uint64_t seed) noexcept {
+    using namespace hash_detail;
+    auto p = static_cast<unsigned char const *>(data);
+    seed ^= mum(seed ^ SECRET_[0], SECRET_[1]);
+    uint64_t a;
+    uint64_t b;
+    if (n <= 16) {
+        if (n >= 4) {
+            a = (read4(p) << 32) | read4(p + ((n >> 3) << 2));
+            b = (read4(p + n - 4) << 32) | read4(p + n - 4 - ((n >> 3) << 2));
+        } else if (n > 0) {
+            a = (uint64_t(p[0]) << 16) | (uint64_t(p[n >> 1]) << 8) | p[n - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = n;
+        if (i > 48) {
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = mum(read8(p) ^ SECRET_[1], read8(p + 8) ^ seed);
+                see1 = mum(read8(p + 16) ^ SECRET_[2], read8(p + 24) ^ see1);
+                see2 = mum(read8(p + 32) ^ SECRET_[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mum(read8(p) ^ SECRET_[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    return mum(SECRET_[1] ^ n, mum(a ^ SECRET_[1], b ^ seed));
+}
+
+// _____________________________________________________________________________________________
+// search
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+// equality mask of 32 bytes at p, sizeof(T) bits per integral element, one per floating
+template<typename T>
+__attribute__((target("avx2")))
+inline uint32_t eq_mask_avx2(T const *p, T value) noexcept {
+    if constexpr (std::is_same<T, float>::value) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), _mm256_set1_ps(value),
+                                                _CMP_EQ_OQ));
+    } else if constexpr (std::is_same<T, double>::value) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_set1_pd(value),
+                                                _CMP_EQ_OQ));
+    } else {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+        __m256i eq;
+        if constexpr (sizeof(T) == 1) {
+            eq = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(static_cast<char>(value)));
+        } else if constexpr (sizeof(T) == 2) {
+            eq = _mm256_cmpeq_epi16(x, _mm256_set1_epi16(static_cast<short>(value)));
+        } else if constexpr (sizeof(T) == 4) {
+            eq = _mm256_cmpeq_epi32(x, _mm256_set1_epi32(static_cast<int>(value)));
+        } else {
+            eq = _mm256_cmpeq_epi64(x, _mm256_set1_epi64x(static_cast<long long>(value)));
+        }
+        return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+    }
+}
+
+// equality mask of 64 bytes at p, one bit per element
+template<typename T>
+__attribute__((target("avx512f,avx512bw")))
+inline uint64_t eq_mask_avx512(T const *p, T value) noexcept {
+    if constexpr (std::is_same<T, float>::value) {
+        return _mm512_cmp_ps_mask(_mm512_loadu_ps(p), _mm512_set1_ps(value), _CMP_EQ_OQ);
+    } else if constexpr (std::is_same<T, double>::value) {
+        return _mm512_cmp_pd_mask(_mm512_loadu_pd(p), _mm512_set1_pd(value), _CMP_EQ_OQ);
+    } else {
+        __m512i x = _mm512_loadu_si512(p);
+        if constexpr (sizeof(T) == 1) {
+            return _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8(static_cast<char>(value)));
+        } else if constexpr (sizeof(T) == 2) {
+            return _mm512_cmpeq_epi16_mask(x, _mm512_set1_epi16(static_cast<short>(value)));
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm512_cmpeq_epi32_mask(x, _mm512_set1_epi32(static_cast<int>(value)));
+        } else {
+            return _mm512_cmpeq_epi64_mask(x, _mm512_set1_epi64(static_cast<long long>(value)));
+        }
+    }
+}
+
+template<typename T>
+constexpr size_t avx2_mask_bits() noexcept {
+    return std::is_floating_point<T>::value ? 1 : sizeof(T);
+}
+
+// first element of [p, p + n) equal to one of values[0, k)
+template<typename T>
+__attribute__((target("avx2")))
+inline size_t find_any_avx2(T const *p, size_t n, T const *values, size_t k) noexcept {
+    constexpr size_t lanes = 32 / sizeof(T);
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        uint32_t mask = 0;
+        for (size_t j = 0; j != k; ++j) {
+            mask |= eq_mask_avx2(p + i, values[j]);
+        }
+        if (mask != 0) {
+            return i + __builtin_ctz(mask) / avx2_mask_bits<T>();
+        }
+    }
+    return i + (std::find_first_of(p + i, p + n, values, values + k) - (p + i));
+}
+
+template<typename T>
+__attribute__((target("avx512f,avx512bw")))
+inline size_t find_any_avx512(T const *p, size_t n, T const *values, size_t k) noexcept {
+    constexpr size_t lanes = 64 / sizeof(T);
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        uint64_t mask = 0;
+        for (size_t j = 0; j != k; ++j) {
+            mask |= eq_mask_avx512(p + i, values[j]);
+        }
+        if (mask != 0) {
+            return i + __builtin_ctzll(mask);
+        }
+    }
+    return i + (std::find_first_of(p + i, p + n, values, values + k) - (p + i));
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+inline size_t count_avx2(T const *p, size_t n, T value) noexcept {
+    constexpr size_t lanes = 32 / sizeof(T);
+    size_t i = 0;
+    size_t bits = 0;
+    for (; i + lanes <= n; i += lanes) {
+        bits += __builtin_popcount(eq_mask_avx2(p + i, value));
+    }
+    return bits / avx2_mask_bits<T>() + std::count(p + i, p + n, value);
+}
+
+template<typename T>
+__attribute__((target("avx512f,avx512bw")))
+inline size_t count_avx512(T const *p, size_t n, T value) noexcept {
+    constexpr size_t lanes = 64 / sizeof(T);
+    size_t i = 0;
+    size_t result = 0;
+    for (; i + lanes <= n; i += lanes) {
+        result += __builtin_popcountll(eq_mask_avx512(p + i, value));
+    }
+    return result + std::count(p + i, p + n, value);
+}
+#endif
+
+// index of the first element equal to one of values[0, k), n if there is none
+template<typename T>
+size_t find_any(T const *p, size_t n, T const *values, size_t k) {
+#ifdef SUPER_VECTOR_X86_DISPATCH
+    if constexpr (is_searchable<T>::value) {
+        if (has_avx512()) {
+            return find_any_avx512(p, n, values, k);
+        }
+        if (has_avx2()) {
+            return find_any_avx2(p, n, values, k);
+        }
+    }
+#endif
+    return std::find_first_of(p, p + n, values, values + k) - p;
+}
+
+// index of the first element equal to value, n if there is none
+template<typename T>
+size_t find(T const *p, size_t n, T const &value) {
+    return find_any(p, n, &value, 1);
+}
+
+template<typename T>
+size_t count(T const *p, size_t n, T const &value) {
+#ifdef SUPER_VECTOR_X86_DISPATCH
+    if constexpr (is_searchable<T>::value) {
+        if (has_avx512()) {
+            return count_avx512(p, n, value);
+        }
+        if (has_avx2()) {
+            return count_avx2(p, n, value);
+        }
+    }
+#endif
+    return std::count(p, p + n, value);
+}
+
+// _____________________________________________________________________________________________
+// compress
+
+// element types moved as raw 4 or 8 byte lanes by the compress kernels
+template<typename T>
+struct is_compressible : std::integral_constant<bool,
+    std::is_arithmetic<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)> {};
+
+// keeps p[i + j] for every set bit j of bits(i), i runs over [0, n) in steps of 64 and
+// only the low n - i bits count in the last step; returns the number of kept elements
+template<typename T, typename Bits>
+size_t compress_scalar(T *p, size_t n, size_t i, size_t out, Bits const &bits) {
+    for (; i < n; i += 64) {
+        uint64_t mask = bits(i);
+        size_t block = std::min<size_t>(64, n - i);
+        for (size_t j = 0; j != block; ++j) {
+            p[out] = p[i + j];
+            out += (mask >> j) & 1;
+        }
+    }
+    return out;
+}
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+template<typename T, typename Bits>
+__attribute__((target("avx512f")))
+size_t compress_avx512(T *p, size_t n, Bits const &bits) {
+    constexpr size_t lanes = 64 / sizeof(T);
+    size_t i = 0;
+    size_t out = 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t mask = bits(i);
+        for (size_t j = 0; j != 64; j += lanes) {
+            // full width store, everything it overwrites past out is already loaded
+            __m512i x = _mm512_loadu_si512(p + i + j);
+            if constexpr (sizeof(T) == 4) {
+                __mmask16 m = static_cast<__mmask16>(mask >> j);
+                _mm512_storeu_si512(p + out, _mm512_maskz_compress_epi32(m, x));
+                out += __builtin_popcount(m);
+            } else {
+                __mmask8 m = static_cast<__mmask8>(mask >> j);
+                _mm512_storeu_si512(p + out, _mm512_maskz_compress_epi64(m, x));
+                out += __builtin_popcount(m);
+            }
+        }
+    }
+    return compress_scalar(p, n, i, out, bits);
+}
+
+// permutation of 8 dword lanes moving the lanes of every set bit to the front
+struct compress_lut {
+  uint32_t perm[256][8];
+  // every bit of a 4 bit qword mask doubled into a dword mask
+  uint8_t widen[16];
+
+  compress_lut() noexcept {
+      for (unsigned m = 0; m != 256; ++m) {
+          unsigned k = 0;
+          for (unsigned j = 0; j != 8; ++j) {
+              if (m >> j & 1) {
+                  perm[m][k++] = j;
+              }
+          }
+          for (; k != 8; ++k) {
+              perm[m][k] = 0;
+          }
+      }
+      for (unsigned m = 0; m != 16; ++m) {
+          widen[m] = 0;
+          for (unsigned j = 0; j != 4; ++j) {
+              widen[m] |= (m >> j & 1) * (3u << (2 * j));
+          }
+      }
+  }
+
+  static compress_lut const &get() noexcept {
+      static const compress_lut lut;
+      return lut;
+  }
+};
+
+template<typename T, typename Bits>
+__attribute__((target("avx2")))
+size_t compress_avx2(T *p, size_t n, Bits const &bits) {
+    constexpr size_t lanes = 32 / sizeof(T);
+    compress_lut const &lut = compress_lut::get();
+    size_t i = 0;
+    size_t out = 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t mask = bits(i);
+        for (size_t j = 0; j != 64; j += lanes) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + i + j));
+            unsigned m = static_cast<unsigned>(mask >> j) & ((1u << lanes) - 1);
+            unsigned dwords = sizeof(T) == 4 ? m : lut.widen[m];
+            __m256i perm = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(lut.perm[dwords]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + out),
+                                _mm256_permutevar8x32_epi32(x, perm));
+            out += __builtin_popcount(m);
+        }
+    }
+    return compress_scalar(p, n, i, out, bits);
+}
+#endif
+
+// moves the kept elements of p to the front in order, bits as in compress_scalar
+template<typename T, typename Bits>
+size_t compress(T *p, size_t n, Bits const &bits) {
+#ifdef SUPER_VECTOR_X86_DISPATCH
+    if constexpr (is_compressible<T>::value) {
+        if (has_avx512()) {
+            return compress_avx512(p, n, bits);
+        }
+        if (has_avx2()) {
+            return compress_avx2(p, n, bits);
+        }
+    }
+#endif
+    return compress_scalar(p, n, 0, 0, bits);
+}
+
+// _____________________________________________________________________________________________
+// popcount
+
+inline size_t popcount_scalar(uint64_t const *p, size_t n) noexcept {
+    size_t result = 0;
+    for (size_t i = 0; i != n; ++i) {
+        result += __builtin_popcountll(p[i]);
+    }
+    return result;
+}
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+__attribute__((target("popcnt")))
+inline size_t popcount_popcnt(uint64_t const *p, size_t n) noexcept {
+    return popcount_scalar(p, n);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+inline size_t popcount_avx512(uint64_t const *p, size_t n) noexcept {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(p + i)));
+    }
+    if (i != n) {
+        __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(tail, p + i)));
+    }
+    // stored and summed by hand, _mm512_reduce_add_epi64 trips -Wuninitialized in gcc
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, acc);
+    size_t result = 0;
+    for (uint64_t lane : lanes) {
+        result += lane;
+    }
+    return result;
+}
+#endif
+
+// number of set bits in n words
+inline size_t popcount(uint64_t const *p, size_t n) noexcept {
+#ifdef SUPER_VECTOR_X86_DISPATCH
+    if (has_avx512_popcount()) {
+        return popcount_avx512(p, n);
+    }
+    if (has_popcnt()) {
+        return popcount_popcnt(p, n);
+    }
+#endif
+    return popcount_scalar(p, n);
+}
+
+// _____________________________________________________________________________________________
+// fill
+
+// fills past this many bytes bypass the cache, they would only evict the working set
+constexpr size_t STREAM_FILL_BYTES_ = size_t(2) << 20;
+
+// the byte every byte of value equals, -1 if they differ
+template<typename T>
+int repeated_byte(T const &value) noexcept {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (size_t i = 1; i != sizeof(T); ++i) {
+        if (bytes[i] != bytes[0]) {
+            return -1;
+        }
+    }
+    return bytes[0];
+}
+
+// pattern is 64 bytes of whole copies of the value, the n bytes at p get the same
+// repetition; returns the byte offset where the kernel stopped
+inline size_t fill_head_scalar(unsigned char *p, size_t n, unsigned char const *pattern) noexcept {
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::memcpy(p + i, pattern, 64);
+    }
+    return i;
+}
+
+#ifdef SUPER_VECTOR_X86_DISPATCH
+// the pattern as seen from the first 64 byte aligned address of p, it is periodic in
+// the element size, so a rotation keeps it a sequence of whole values
+inline size_t aligned_pattern(unsigned char *p, unsigned char const *pattern,
+                              unsigned char *rotated) noexcept {
+    size_t head = (64 - reinterpret_cast<uintptr_t>(p) % 64) % 64;
+    for (size_t k = 0; k != 64; ++k) {
+        rotated[k] = pattern[(k + head) % 64];
+    }
+    std::memcpy(p, pattern, head);
+    return head;
+}
+
+__attribute__((target("avx512f")))
+inline size_t fill_head_avx512(unsigned char *p, size_t n, unsigned char const *pattern) noexcept {
+    size_t i = 0;
+    if (n >= STREAM_FILL_BYTES_) {
+        unsigned char rotated[64];
+        i = aligned_pattern(p, pattern, rotated);
+        __m512i x = _mm512_loadu_si512(rotated);
+        for (; i + 64 <= n; i += 64) {
+            _mm512_stream_si512(reinterpret_cast<__m512i *>(p + i), x);
+        }
+        _mm_sfence();
+        std::memcpy(p + i, rotated, n - i);
+        return n;
+    }
+    __m512i x = _mm512_loadu_si512(pattern);
+    for (; i + 64 <= n; i += 64) {
+        _mm512_storeu_si512(p + i, x);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t fill_head_avx2(unsigned char *p, size_t n, unsigned char const *pattern) noexcept {
+    size_t i = 0;
+    if (n >= STREAM_FILL_BYTES_) {
+        unsigned char rotated[64];
+        i = aligned_pattern(p, pattern, rotated);
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(rotated));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(rotated + 32));
+        for (; i + 64 <= n; i += 64) {
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(p + i), lo);
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(p + i + 32), hi);
+        }
+        _mm_sfence();
+        std::memcpy(p + i, rotated, n - i);
+        return n;
+    }
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(pattern));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(pattern + 32));
+    for (; i + 64 <= n; i += 64) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i + 32), hi);
+    }
+    return i;
+}
+#endif
+
+// constructs n copies of value at p, trivially copyable T only: memset when the value is
+// one repeated byte, wide broadcast stores otherwise, streaming stores for huge fills
+template<typename T>
+void fill(T *p, size_t n, T const &value) noexcept {
+    static_assert(std::is_trivially_copyable<T>::value, "trivially copyable type expected");
+    int byte = repeated_byte(value);
+    if (byte >= 0) {
+        std::memset(static_cast<void *>(p), byte, n * sizeof(T));
+        return;
+    }
+    if constexpr (64 % sizeof(T) == 0) {
+        unsigned char pattern[64];
+        for (size_t k = 0; k != 64; k += sizeof(T)) {
+            std::memcpy(pattern + k, &value, sizeof(T));
+        }
+        auto bytes = reinterpret_cast<unsigned char *>(p);
+        size_t total = n * sizeof(T);
+        size_t done;
+#ifdef SUPER_VECTOR_X86_DISPATCH
+        if (has_avx512()) {
+            done = fill_head_avx512(bytes, total, pattern);
+        } else if (has_avx2()) {
+            done = fill_head_avx2(bytes, total, pattern);
+        } else
+#endif
+        {
+            done = fill_head_scalar(bytes, total, pattern);
+        }
+        std::memcpy(bytes + done, pattern, total - done);
+    } else {
+        std::uninitialized_fill_n(p, n, value);
+    }
+}
+
+} // namespace vector_simd
+
+#endif //SUPER_VECTOR__VECTOR_SIMD_HPP_
@@ -1,8 +1,37 @@
 #include "gtest/gtest.h"
 #include "fault_injection.h"
 #include "vector.hpp"
+#include "paged_vector.hpp"
+#include "concurrent_vector.hpp"
+#include "published_vector.hpp"
+#include "vector_numeric.hpp"
+#include "vector_expr.hpp"
+#include "flat_map.hpp"
+#include "parallel_sort.hpp"
+#include "radix_sort.hpp"
+#include "bit_vector.hpp"
+#include "vector_parallel.hpp"
+#include "compressed_vector.hpp"
+#include "serialization.hpp"
+#include "mapped_vector.hpp"
+#include "persistent_vector.hpp"
+#include "shm_vector.hpp"
+#include "vector_arrow.hpp"
+#include "checkpoint.hpp"
 #include "counted.h"
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <sys/wait.h>
+#include <unordered_set>
+#include <vector>
+
 typedef vector<counted> container;
 typedef vector<int> container_int;
 
@@ -462,6 +491,73 @@ TEST(correctness, reserve_2)
     });
 }
 
+TEST(correctness, sharing_introspection)
+{
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        container c;
+        EXPECT_EQ(0u, c.use_count());
+        c.push_back(1);
+        EXPECT_EQ(1u, c.use_count());
+        c.push_back(2);
+        c.push_back(3);
+        container d = c;
+        EXPECT_EQ(2u, c.use_count());
+        EXPECT_TRUE(c.is_shared());
+        EXPECT_TRUE(d.is_shared());
+        d.unshare();
+        EXPECT_FALSE(c.is_shared());
+        EXPECT_FALSE(d.is_shared());
+        EXPECT_EQ(3, d[2]);
+    });
+}
+
+TEST(correctness, reserve_unique)
+{
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        container c;
+        c.push_back(1);
+        c.reserve_unique(10);
+        EXPECT_LE(10u, c.capacity());
+        c.push_back(2);
+        container d = c;
+        d.reserve_unique(5);
+        EXPECT_FALSE(c.is_shared());
+        EXPECT_LE(10u, d.capacity());
+        counted const* p = d.data();
+        for (int i = 0; i != 8; ++i)
+            d.push_back(i);
+        EXPECT_EQ(p, d.data());
+        EXPECT_EQ(2u, c.size());
+        EXPECT_EQ(10u, d.size());
+    });
+}
+
+TEST(correctness, resize)
+{
+    faulty_run([]
+    {
+        container_int c;
+        c.resize(1);
+        EXPECT_EQ(1u, c.size());
+        c[0] = 7;
+        c.resize(5);
+        EXPECT_EQ(5u, c.size());
+        EXPECT_EQ(7, c[0]);
+        EXPECT_EQ(0, c[4]);
+        container_int d = c;
+        d.resize(2);
+        EXPECT_EQ(2u, d.size());
+        EXPECT_EQ(5u, c.size());
+        c.resize(0);
+        EXPECT_TRUE(c.empty());
+        EXPECT_EQ(7, d[0]);
+    });
+}
+
 TEST(correctness, front_back)
 {
     faulty_run([]
@@ -796,6 +892,56 @@ TEST(correctness, const_reverse_iterators)
     });
 }
 
+#if __cplusplus > 201703L
+static_assert(std::contiguous_iterator<container::iterator>);
+static_assert(std::contiguous_iterator<container::const_iterator>);
+#endif
+
+TEST(correctness, iterator_arithmetic)
+{
+    faulty_run([]
+    {
+        container_int c;
+        for (int i = 0; i != 5; ++i)
+            c.push_back(i);
+        container_int::const_iterator const b = c.cbegin();
+        container_int::const_iterator const e = c.cend();
+        EXPECT_TRUE(b < e);
+        EXPECT_TRUE(e >= b);
+        EXPECT_EQ(2, *(2 + b));
+        EXPECT_EQ(3, b[3]);
+        EXPECT_EQ(4, *(e - 1));
+        EXPECT_EQ(e, b + 5);
+        int out[5];
+        std::copy(c.cbegin(), c.cend(), out);
+        EXPECT_EQ(4, out[4]);
+    });
+}
+
+TEST(correctness, insert_erase_shared)
+{
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        container c;
+        for (int i = 0; i != 4; ++i)
+            c.push_back(i);
+        container d = c;
+        container const& cd = d;
+        d.insert(cd.begin() + 1, 10);
+        EXPECT_EQ(5u, d.size());
+        EXPECT_EQ(10, d[1]);
+        EXPECT_EQ(1, d[2]);
+        container e = d;
+        container const& ce = e;
+        e.erase(ce.begin() + 3, ce.end());
+        EXPECT_EQ(3u, e.size());
+        EXPECT_EQ(5u, d.size());
+        EXPECT_EQ(4u, c.size());
+        EXPECT_EQ(1, c[1]);
+    });
+}
+
 TEST(correctness, comparison_empty_empty)
 {
     faulty_run([]
@@ -866,6 +1012,228 @@ TEST(correctness, comparison_long)
     });
 }
 
+TEST(correctness, comparison_bytes)
+{
+    faulty_run([]
+    {
+        vector<unsigned char> a, b;
+        for (int i = 0; i != 100; ++i)
+        {
+            a.push_back(static_cast<unsigned char>(i));
+            b.push_back(static_cast<unsigned char>(i));
+        }
+        EXPECT_TRUE(a == b);
+        b[77] = 200;
+        EXPECT_FALSE(a == b);
+        EXPECT_TRUE(a < b);
+        EXPECT_TRUE(b > a);
+        vector<unsigned char> c = a;
+        EXPECT_TRUE(a == c);
+        EXPECT_FALSE(a < c);
+    });
+}
+
+TEST(correctness, comparison_signed_bytes)
+{
+    vector<signed char> a, b;
+    a.push_back(1);
+    a.push_back(-5);
+    b.push_back(1);
+    b.push_back(5);
+    EXPECT_TRUE(a < b);
+    EXPECT_FALSE(b < a);
+    vector<std::byte> c, d;
+    c.push_back(std::byte{1});
+    c.push_back(std::byte{250});
+    d.push_back(std::byte{1});
+    d.push_back(std::byte{5});
+    EXPECT_TRUE(d < c);
+    c.pop_back();
+    EXPECT_TRUE(c < d);
+    EXPECT_FALSE(vector<std::byte>() < vector<std::byte>());
+}
+
+TEST(correctness, comparison_wide)
+{
+    faulty_run([]
+    {
+        container_int a, b;
+        for (int i = 0; i != 70; ++i)
+        {
+            a.push_back(i - 35);
+            b.push_back(i - 35);
+        }
+        EXPECT_TRUE(a == b);
+        b[65] = -1000;
+        EXPECT_FALSE(a == b);
+        EXPECT_TRUE(b < a);
+        EXPECT_FALSE(a < b);
+        b[65] = a[65];
+        b.pop_back();
+        EXPECT_TRUE(b < a);
+        EXPECT_TRUE(a != b);
+    });
+}
+
+TEST(correctness, search)
+{
+    faulty_run([]
+    {
+        vector<uint32_t> c;
+        for (uint32_t i = 0; i != 1000; ++i)
+            c.push_back(i % 100);
+        vector<uint32_t> d = c;
+        EXPECT_EQ(42u, c.find(42));
+        EXPECT_EQ(c.npos, c.find(100));
+        EXPECT_EQ(10u, c.count(99));
+        EXPECT_TRUE(c.contains(0));
+        EXPECT_FALSE(c.contains(1000));
+        uint32_t const values[] = {500, 77, 13};
+        EXPECT_EQ(13u, c.find_first_of(values, 3));
+        EXPECT_EQ(c.npos, c.find_first_of(values, 1));
+        EXPECT_TRUE(c.is_shared());
+    });
+}
+
+TEST(correctness, search_small_types)
+{
+    faulty_run([]
+    {
+        vector<char> c;
+        for (int i = 0; i != 300; ++i)
+            c.push_back(static_cast<char>('a' + i % 26));
+        EXPECT_EQ(25u, c.find('z'));
+        EXPECT_EQ(12u, c.count('a'));
+        vector<double> d;
+        for (int i = 0; i != 40; ++i)
+            d.push_back(i * 0.5);
+        EXPECT_EQ(0u, d.find(-0.0));
+        EXPECT_EQ(37u, d.find(18.5));
+        EXPECT_EQ(1u, d.count(19.5));
+        counted::no_new_instances_guard g;
+        container e;
+        e.push_back(3);
+        e.push_back(5);
+        EXPECT_EQ(1u, e.find(5));
+    });
+}
+
+#ifdef SUPER_VECTOR_SHARED_REFCOUNT
+TEST(shared_refcount, copies_from_many_threads)
+{
+    container_int shared;
+    for (int i = 0; i != 1000; ++i)
+        shared.push_back(i);
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t != 4; ++t)
+    {
+        threads.emplace_back([&shared, &mismatches, t]
+        {
+            for (int i = 0; i != 20000; ++i)
+            {
+                container_int copy = shared;
+                container_int second = copy;
+                if (i % 100 == 0)
+                {
+                    second[0] = t;
+                    mismatches += second[0] != t || std::as_const(copy)[0] != 0;
+                }
+                mismatches += std::as_const(copy)[999] != 999;
+            }
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+    EXPECT_EQ(0, mismatches.load());
+    EXPECT_EQ(1u, shared.use_count());
+    EXPECT_EQ(0, std::as_const(shared)[0]);
+}
+#endif
+
+TEST(correctness, hash)
+{
+    faulty_run([]
+    {
+        container_int a, b;
+        for (int i = 0; i != 1000; ++i)
+        {
+            a.push_back(i);
+            b.push_back(i);
+        }
+        std::hash<container_int> h;
+        EXPECT_EQ(h(a), h(b));
+        container_int c = a;
+        EXPECT_EQ(h(a), h(c));
+        c[500] = -1;
+        EXPECT_NE(h(a), h(c));
+        c[500] = 500;
+        EXPECT_EQ(h(a), h(c));
+        c.push_back(0);
+        EXPECT_NE(h(a), h(c));
+        c.pop_back();
+        EXPECT_EQ(h(a), h(c));
+        EXPECT_NE(h(container_int()), h(a));
+    });
+}
+
+#ifdef SUPER_VECTOR_CACHED_HASH
+TEST(correctness, cached_hash_invalidation)
+{
+    auto fresh = [](container_int const& v)
+    {
+        container_int copy;
+        for (int x : v)
+            copy.push_back(x);
+        return copy.hash_code();
+    };
+    container_int a;
+    for (int i = 0; i != 1000; ++i)
+        a.push_back(i);
+    size_t before = a.hash_code();
+    container_int shared = a;
+    EXPECT_EQ(before, shared.hash_code());
+    shared[10] = -1;
+    EXPECT_EQ(before, a.hash_code());
+    EXPECT_EQ(fresh(shared), shared.hash_code());
+
+    a.hash_code();
+    a[10] = -1;
+    EXPECT_EQ(fresh(a), a.hash_code());
+    a.push_back(5);
+    EXPECT_EQ(fresh(a), a.hash_code());
+    a.pop_back();
+    EXPECT_EQ(fresh(a), a.hash_code());
+    a.data()[0] = 7;
+    EXPECT_EQ(fresh(a), a.hash_code());
+    a.resize(2000);
+    EXPECT_EQ(fresh(a), a.hash_code());
+    a.fill(3);
+    EXPECT_EQ(fresh(a), a.hash_code());
+    a.iota(1);
+    EXPECT_EQ(fresh(a), a.hash_code());
+    EXPECT_EQ(1u, erase_if(a, [](int x) { return x == 5; }));
+    EXPECT_EQ(fresh(a), a.hash_code());
+    *a.begin() = 42;
+    EXPECT_EQ(fresh(a), a.hash_code());
+}
+#endif
+
+TEST(correctness, hash_set_keys)
+{
+    std::unordered_set<vector<unsigned char>> keys;
+    for (int i = 0; i != 100; ++i)
+    {
+        vector<unsigned char> key;
+        key.push_back(static_cast<unsigned char>(i));
+        for (int j = 0; j != i % 40; ++j)
+            key.push_back(static_cast<unsigned char>(j * i));
+        keys.insert(key);
+        keys.insert(key);
+    }
+    EXPECT_EQ(100u, keys.size());
+}
+
 TEST(correctness, swap_empty_self)
 {
     faulty_run([]
@@ -1019,3 +1387,1342 @@ TEST(exceptions, reserve)
         });
     });
 }
+
+TEST(paged, push_back_and_read)
+{
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        paged_vector<counted, 4 * sizeof(counted)> c;
+        for (int i = 0; i != 19; ++i)
+            c.push_back(i);
+        EXPECT_EQ(19u, c.size());
+        EXPECT_EQ(5u, c.page_count());
+        for (int i = 0; i != 19; ++i)
+            EXPECT_EQ(i, c[i]);
+        for (int i = 0; i != 6; ++i)
+            c.pop_back();
+        EXPECT_EQ(13u, c.size());
+        EXPECT_EQ(12, c.back());
+    });
+}
+
+TEST(paged, write_copies_one_page)
+{
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        paged_vector<counted, 4 * sizeof(counted)> c;
+        for (int i = 0; i != 16; ++i)
+            c.push_back(i);
+        paged_vector<counted, 4 * sizeof(counted)> d = c;
+        d[5] = 42;
+        EXPECT_EQ(5, c[5]);
+        EXPECT_EQ(42, d[5]);
+        EXPECT_TRUE(d.is_page_shared(0));
+        EXPECT_FALSE(d.is_page_shared(1));
+        EXPECT_TRUE(d.is_page_shared(2));
+        EXPECT_EQ(c.page_data(0), d.page_data(0));
+        EXPECT_NE(c.page_data(1), d.page_data(1));
+        d.push_back(16);
+        d.pop_back();
+        d.pop_back();
+        EXPECT_EQ(16u, c.size());
+        EXPECT_EQ(15, c[15]);
+        EXPECT_EQ(14, d.back());
+    });
+}
+
+TEST(concurrent, push_back_stable_addresses)
+{
+    counted::no_new_instances_guard g;
+    concurrent_vector<counted> c;
+    c.push_back(0);
+    counted const* first = &c[0];
+    for (int i = 1; i != 1000; ++i)
+        c.push_back(i);
+    EXPECT_EQ(1000u, c.size());
+    EXPECT_EQ(first, &c[0]);
+    for (int i = 0; i != 1000; ++i)
+        EXPECT_EQ(i, c[i]);
+}
+
+TEST(concurrent, multi_producer)
+{
+    concurrent_vector<int> c;
+    std::vector<std::thread> threads;
+    size_t const producers = 8;
+    int const per_thread = 10000;
+    for (size_t t = 0; t != producers; ++t)
+        threads.emplace_back([&c, per_thread]
+        {
+            for (int i = 0; i != per_thread; ++i)
+                c.push_back(i);
+        });
+    std::thread reader([&c]
+    {
+        for (size_t i = 0; i != c.size(); ++i)
+        {
+            if (c.is_published(i))
+            {
+                EXPECT_LE(0, c[i]);
+            }
+        }
+    });
+    for (std::thread& t : threads)
+        t.join();
+    reader.join();
+
+    ASSERT_EQ(producers * per_thread, c.size());
+    std::vector<int> seen(per_thread);
+    for (size_t i = 0; i != c.size(); ++i)
+    {
+        ASSERT_TRUE(c.is_published(i));
+        ++seen[c[i]];
+    }
+    for (int cnt : seen)
+        EXPECT_EQ(int(producers), cnt);
+}
+
+TEST(published, snapshot_survives_publish)
+{
+    counted::no_new_instances_guard g;
+    container c;
+    c.push_back(1);
+    c.push_back(2);
+    published_vector<counted> p(c);
+    published_vector<counted>::reader r = p.make_reader();
+    {
+        published_vector<counted>::snapshot s = r.read();
+        p.update([](container& v)
+        {
+            v[0] = 10;
+            v.push_back(3);
+        });
+        EXPECT_EQ(1, (*s)[0]);
+        EXPECT_EQ(2u, s->size());
+        EXPECT_EQ(1u, p.retired_count());
+    }
+    p.collect();
+    EXPECT_EQ(0u, p.retired_count());
+    published_vector<counted>::snapshot s = r.read();
+    EXPECT_EQ(10, (*s)[0]);
+    EXPECT_EQ(3u, s->size());
+}
+
+TEST(published, nested_snapshots)
+{
+    counted::no_new_instances_guard g;
+    container c;
+    c.push_back(1);
+    published_vector<counted> p(c);
+    published_vector<counted>::reader r = p.make_reader();
+    {
+        published_vector<counted>::snapshot outer = r.read();
+        p.update([](container& v) { v[0] = 2; });
+        {
+            published_vector<counted>::snapshot inner = r.read();
+            EXPECT_EQ(2, (*inner)[0]);
+            p.update([](container& v) { v[0] = 3; });
+        }
+        p.collect();
+        EXPECT_EQ(2u, p.retired_count());
+        EXPECT_EQ(1, (*outer)[0]);
+    }
+    p.collect();
+    EXPECT_EQ(0u, p.retired_count());
+}
+
+TEST(published, concurrent_readers)
+{
+    vector<int> initial;
+    initial.push_back(0);
+    initial.push_back(0);
+    published_vector<int> p(initial);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t != 4; ++t)
+        readers.emplace_back([&p, &done]
+        {
+            published_vector<int>::reader r = p.make_reader();
+            while (!done.load())
+            {
+                published_vector<int>::snapshot s = r.read();
+                EXPECT_EQ((*s)[0], (*s)[1]);
+            }
+        });
+    for (int i = 1; i != 1000; ++i)
+        p.update([i](vector<int>& v)
+        {
+            v[0] = i;
+            v[1] = i;
+        });
+    done.store(true);
+    for (std::thread& t : readers)
+        t.join();
+    p.collect();
+    EXPECT_EQ(0u, p.retired_count());
+    EXPECT_EQ(999, (*p.make_reader().read())[0]);
+}
+
+TEST(numeric, sum_dot_minmax)
+{
+    vector<int> a;
+    vector<int> b;
+    for (int i = 0; i != 1000; ++i)
+    {
+        a.push_back(i - 300);
+        b.push_back(2);
+    }
+    vector<int> shared = a;
+    EXPECT_EQ(499500 - 300000, numeric::sum(a));
+    EXPECT_EQ(2 * (499500 - 300000), numeric::dot(a, b));
+    EXPECT_EQ(std::make_pair(-300, 699), numeric::minmax(a));
+    EXPECT_EQ(0u, numeric::argmin(a));
+    EXPECT_EQ(999u, numeric::argmax(a));
+    EXPECT_TRUE(a.is_shared());
+    EXPECT_THROW(numeric::minmax(vector<int>()), std::runtime_error);
+}
+
+TEST(numeric, floating_sum_modes)
+{
+    vector<double> v;
+    v.push_back(1e16);
+    for (int i = 0; i != 1000; ++i)
+        v.push_back(1.0);
+    v.push_back(-1e16);
+    EXPECT_DOUBLE_EQ(1000.0, numeric::sum(v, numeric::summation::kahan));
+    vector<float> f;
+    for (int i = 0; i != 5000; ++i)
+        f.push_back(0.5f);
+    EXPECT_FLOAT_EQ(2500.0f, numeric::sum(f, numeric::summation::pairwise));
+    EXPECT_FLOAT_EQ(2500.0f, numeric::sum(f));
+    EXPECT_FLOAT_EQ(0.5f, numeric::minmax(f).second);
+}
+
+TEST(numeric, argmin_argmax_nan)
+{
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+    vector<double> v;
+    for (int i = 0; i != 1000; ++i)
+        v.push_back(i % 7 == 0 ? nan : 100.0 - i % 50);
+    v[0] = nan;
+    v[333] = -5.0;
+    v[666] = -5.0;
+    v[901] = 200.0;
+    EXPECT_EQ(333u, numeric::argmin(v));
+    EXPECT_EQ(901u, numeric::argmax(v));
+    EXPECT_EQ(std::make_pair(-5.0, 200.0), numeric::minmax(v));
+    vector<double> nans(20, nan);
+    EXPECT_EQ(0u, numeric::argmin(nans));
+    EXPECT_TRUE(std::isnan(numeric::minmax(nans).first));
+    vector<float> ties(100, 1.0f);
+    EXPECT_EQ(0u, numeric::argmin(ties));
+    EXPECT_EQ(0u, numeric::argmax(ties));
+}
+
+TEST(numeric, histogram)
+{
+    vector<double> v;
+    for (int i = 0; i != 100; ++i)
+        v.push_back(i / 10.0);
+    v.push_back(-1.0);
+    v.push_back(10.0);
+    vector<size_t> h = numeric::histogram(v, 0.0, 10.0, 5);
+    ASSERT_EQ(5u, h.size());
+    for (size_t i = 0; i != 5; ++i)
+        EXPECT_EQ(20u, h[i]);
+}
+
+TEST(expr, fused_arithmetic)
+{
+    vector<float> a, b, c;
+    for (int i = 0; i != 100; ++i)
+    {
+        a.push_back(float(i));
+        b.push_back(2.0f);
+        c.push_back(1.0f);
+    }
+    vector<float> out = a * b + c;
+    ASSERT_EQ(100u, out.size());
+    for (int i = 0; i != 100; ++i)
+        EXPECT_FLOAT_EQ(2.0f * i + 1.0f, out[i]);
+    EXPECT_FALSE(a.is_shared());
+
+    float const* buffer = out.data();
+    out = (a - c) / 2.0f;
+    EXPECT_EQ(buffer, out.data());
+    EXPECT_FLOAT_EQ(49.0f, out[99]);
+}
+
+TEST(expr, aliasing_destination)
+{
+    vector<int> a;
+    for (int i = 0; i != 10; ++i)
+        a.push_back(i);
+    vector<int> shared = a;
+    a = a * a + 1;
+    EXPECT_EQ(82, a[9]);
+    EXPECT_EQ(9, shared[9]);
+    a = 2 * a;
+    EXPECT_EQ(164, a[9]);
+    vector<int> b;
+    b.push_back(1);
+    EXPECT_THROW(a = a + b, std::runtime_error);
+}
+
+TEST(flat, set_insert_find_erase)
+{
+    flat_set<int> s;
+    EXPECT_TRUE(s.insert(5));
+    EXPECT_TRUE(s.insert(1));
+    EXPECT_FALSE(s.insert(5));
+    int const more[] = {9, 3, 1, 7, 3};
+    s.insert(more, more + 5);
+    EXPECT_EQ(5u, s.size());
+    EXPECT_TRUE(std::is_sorted(s.begin(), s.end()));
+    EXPECT_TRUE(s.contains(7));
+    EXPECT_FALSE(s.contains(4));
+    EXPECT_EQ(1u, s.erase(7));
+    EXPECT_EQ(0u, s.erase(7));
+    EXPECT_FALSE(s.contains(7));
+}
+
+TEST(flat, map_layouts_agree)
+{
+    flat_map<int, int> branchless;
+    flat_map<int, int, std::less<int>, search_layout::eytzinger> eytzinger;
+    std::vector<std::pair<int, int>> items;
+    for (int i = 0; i != 300; ++i)
+        items.emplace_back((i * 37) % 1000, i);
+    branchless.insert(items.begin(), items.end());
+    eytzinger.insert(items.begin(), items.end());
+    for (int key = -1; key != 1001; ++key)
+    {
+        int const* a = branchless.find(key);
+        int const* b = std::as_const(eytzinger).find(key);
+        ASSERT_EQ(a == nullptr, b == nullptr);
+        if (a != nullptr)
+        {
+            EXPECT_EQ(*a, *b);
+        }
+    }
+    EXPECT_EQ(0, eytzinger.at(0));
+    eytzinger[1] = 5;
+    EXPECT_EQ(5, eytzinger.at(1));
+    EXPECT_EQ(301u, eytzinger.size());
+    EXPECT_EQ(1u, eytzinger.erase(1));
+    EXPECT_THROW(eytzinger.at(2), std::out_of_range);
+}
+
+TEST(flat, eytzinger_single_inserts_defer_layout)
+{
+    flat_set<int> reference;
+    flat_set<int, std::less<int>, search_layout::eytzinger> s;
+    auto agree = [&]
+    {
+        for (int key = -1; key != 2001; ++key)
+            ASSERT_EQ(reference.lower_bound(key), s.lower_bound(key));
+    };
+    for (int i = 0; i != 500; ++i)
+    {
+        reference.insert((i * 7919) % 2000);
+        s.insert((i * 7919) % 2000);
+    }
+    agree();
+    s.build_layout();
+    agree();
+    for (int key = 0; key < 2000; key += 3)
+        EXPECT_EQ(reference.erase(key), s.erase(key));
+    agree();
+    std::vector<int> more;
+    for (int i = 0; i != 100; ++i)
+        more.push_back(i * 11);
+    reference.insert(more.begin(), more.end());
+    s.insert(more.begin(), more.end());
+    agree();
+}
+
+TEST(flat, map_copy_shares_keys)
+{
+    counted::no_new_instances_guard g;
+    flat_map<int, counted> m;
+    m.insert(2, 20);
+    m.insert(1, 10);
+    m.insert(3, 30);
+    flat_map<int, counted> copy = m;
+    EXPECT_TRUE(m.keys().is_shared());
+    *copy.find(1) = 11;
+    EXPECT_TRUE(m.keys().is_shared());
+    EXPECT_FALSE(m.values().is_shared());
+    EXPECT_EQ(10, m.at(1));
+    EXPECT_EQ(11, copy.at(1));
+    EXPECT_EQ(30, copy.at(3));
+}
+
+TEST(parallel, sort_matches_std_sort)
+{
+    vector<uint64_t> v;
+    std::vector<uint64_t> expected;
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i != (1u << 18); ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        v.push_back(x % 100000);
+        expected.push_back(x % 100000);
+    }
+    vector<uint64_t> copy = v;
+    parallel_sort(v);
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected.size(), v.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), std::as_const(v).begin()));
+    EXPECT_FALSE(std::is_sorted(std::as_const(copy).begin(), std::as_const(copy).end()));
+    parallel_sort(copy, std::greater<uint64_t>(), 3);
+    EXPECT_TRUE(std::equal(expected.rbegin(), expected.rend(), std::as_const(copy).begin()));
+}
+
+TEST(parallel, stable_sort_keeps_order)
+{
+    vector<std::pair<int, int>> v;
+    for (int i = 0; i != 100000; ++i)
+        v.push_back({(i * 7919) % 101, i});
+    parallel_stable_sort(v, [](std::pair<int, int> const& a, std::pair<int, int> const& b)
+    {
+        return a.first < b.first;
+    });
+    std::pair<int, int> const* p = std::as_const(v).data();
+    for (size_t i = 1; i != v.size(); ++i)
+    {
+        ASSERT_TRUE(p[i - 1].first < p[i].first
+                    || (p[i - 1].first == p[i].first && p[i - 1].second < p[i].second));
+    }
+}
+
+// the default pool has no workers on a single core, this one always merges in parallel
+TEST(parallel, merge_path_rounds)
+{
+    parallel_detail::task_pool pool(3);
+    for (size_t threads : {2u, 3u, 4u})
+    {
+        std::vector<uint64_t> v;
+        uint64_t x = 88172645463325252ull;
+        for (size_t i = 0; i != 200003; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            v.push_back(x % 1000);
+        }
+        std::vector<uint64_t> expected = v;
+        std::sort(expected.begin(), expected.end());
+        parallel_detail::merge_sort(pool, v.data(), v.size(), std::less<uint64_t>(), threads,
+                                    [](uint64_t* first, uint64_t* last) { std::sort(first, last); });
+        EXPECT_TRUE(v == expected);
+
+        std::vector<std::pair<int, int>> pairs;
+        for (int i = 0; i != 100003; ++i)
+            pairs.push_back({(i * 7919) % 101, i});
+        auto by_key = [](std::pair<int, int> const& a, std::pair<int, int> const& b)
+        {
+            return a.first < b.first;
+        };
+        parallel_detail::merge_sort(pool, pairs.data(), pairs.size(), by_key, threads,
+                                    [&by_key](std::pair<int, int>* first, std::pair<int, int>* last)
+                                    {
+                                        std::stable_sort(first, last, by_key);
+                                    });
+        for (size_t i = 1; i != pairs.size(); ++i)
+        {
+            ASSERT_TRUE(pairs[i - 1].first < pairs[i].first
+                        || (pairs[i - 1].first == pairs[i].first && pairs[i - 1].second < pairs[i].second));
+        }
+    }
+}
+
+TEST(parallel, sort_propagates_exception)
+{
+    vector<int> v;
+    for (int i = 0; i != 100000; ++i)
+        v.push_back(100000 - i);
+    EXPECT_THROW(parallel_sort(v, [](int a, int b)
+    {
+        if (a == 777 || b == 777)
+            throw std::runtime_error("comparison failed");
+        return a < b;
+    }), std::runtime_error);
+}
+
+TEST(radix, matches_std_sort)
+{
+    vector<int64_t> ints;
+    vector<double> doubles;
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i != 20000; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        ints.push_back(static_cast<int64_t>(x));
+        doubles.push_back(static_cast<double>(static_cast<int64_t>(x)) / 1e6);
+    }
+    doubles.push_back(-0.0);
+    doubles.push_back(0.0);
+    std::vector<int64_t> expected_ints(std::as_const(ints).begin(), std::as_const(ints).end());
+    std::vector<double> expected_doubles(std::as_const(doubles).begin(), std::as_const(doubles).end());
+    std::sort(expected_ints.begin(), expected_ints.end());
+    std::sort(expected_doubles.begin(), expected_doubles.end());
+    radix_sort(ints);
+    radix_sort<11>(doubles);
+    EXPECT_TRUE(std::equal(expected_ints.begin(), expected_ints.end(), std::as_const(ints).begin()));
+    EXPECT_TRUE(std::equal(expected_doubles.begin(), expected_doubles.end(),
+                           std::as_const(doubles).begin()));
+}
+
+TEST(radix, key_extractor_is_stable)
+{
+    struct event
+    {
+        uint32_t time;
+        int id;
+    };
+    vector<event> v;
+    for (int i = 0; i != 5000; ++i)
+        v.push_back({static_cast<uint32_t>((i * 7919) % 97) + 0x12340000u, i});
+    vector<event> copy = v;
+    radix_sort<16>(v, [](event const& e) { return e.time; });
+    EXPECT_EQ(0, copy[0].id);
+    event const* p = std::as_const(v).data();
+    for (size_t i = 1; i != v.size(); ++i)
+    {
+        ASSERT_TRUE(p[i - 1].time < p[i].time || (p[i - 1].time == p[i].time && p[i - 1].id < p[i].id));
+    }
+}
+
+TEST(radix, scratch_is_reused)
+{
+    vector<uint32_t> v;
+    for (uint32_t i = 0; i != 4096; ++i)
+        v.push_back(4096 - i);
+    radix_sort(v);
+    size_t cached = radix_detail::scratch_pool::local().cached_bytes();
+    EXPECT_LE(4096 * sizeof(uint32_t), cached);
+    radix_sort(v, [](uint32_t x) { return -static_cast<int>(x); });
+    EXPECT_EQ(cached, radix_detail::scratch_pool::local().cached_bytes());
+    EXPECT_EQ(4096u, v[0]);
+    EXPECT_EQ(1u, v[4095]);
+}
+
+TEST(radix, scratch_keeps_real_size_and_cap)
+{
+    radix_detail::scratch_pool pool;
+    size_t big = 1 << 20;
+    void* p = pool.acquire(big);
+    pool.release(p, big);
+    size_t small = 1000;
+    p = pool.acquire(small);
+    EXPECT_EQ(size_t(1) << 20, small);
+    pool.release(p, small);
+    EXPECT_EQ(size_t(1) << 20, pool.cached_bytes());
+    size_t huge = radix_detail::scratch_pool::MAX_CACHED + 1;
+    p = pool.acquire(huge);
+    pool.release(p, huge);
+    EXPECT_EQ(size_t(1) << 20, pool.cached_bytes());
+    pool.trim();
+    EXPECT_EQ(0u, pool.cached_bytes());
+}
+
+// every popcount kernel the machine can run against the scalar one, tails included;
+// the avx512 kernel needs VPOPCNTDQ and is skipped without it
+TEST(bits, popcount_kernels_agree)
+{
+    std::vector<uint64_t> words;
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i != 100; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        words.push_back(x);
+    }
+    words[3] = ~uint64_t(0);
+    for (size_t n = 0; n != words.size(); ++n)
+    {
+        size_t expected = vector_simd::popcount_scalar(words.data(), n);
+        EXPECT_EQ(expected, vector_simd::popcount(words.data(), n));
+#ifdef SUPER_VECTOR_X86_DISPATCH
+        if (vector_simd::has_popcnt())
+        {
+            EXPECT_EQ(expected, vector_simd::popcount_popcnt(words.data(), n));
+        }
+        if (vector_simd::has_avx512_popcount())
+        {
+            EXPECT_EQ(expected, vector_simd::popcount_avx512(words.data(), n));
+        }
+#endif
+    }
+}
+
+TEST(filter, erase_if_matches_remove_if)
+{
+    vector<int> ints;
+    vector<double> doubles;
+    vector<short> shorts;
+    for (int i = 0; i != 1000; ++i)
+    {
+        ints.push_back((i * 7919) % 1000);
+        doubles.push_back((i * 7919) % 1000);
+        shorts.push_back(static_cast<short>((i * 7919) % 1000));
+    }
+    vector<int> copy = ints;
+    std::vector<int> expected(std::as_const(ints).begin(), std::as_const(ints).end());
+    expected.erase(std::remove_if(expected.begin(), expected.end(), [](int x) { return x % 3 == 0; }),
+                   expected.end());
+    EXPECT_EQ(1000u - expected.size(), erase_if(ints, [](int x) { return x % 3 == 0; }));
+    EXPECT_EQ(1000u - expected.size(), erase_if(doubles, [](double x) { return static_cast<int>(x) % 3 == 0; }));
+    EXPECT_EQ(1000u - expected.size(), erase_if(shorts, [](short x) { return x % 3 == 0; }));
+    ASSERT_EQ(expected.size(), ints.size());
+    for (size_t i = 0; i != expected.size(); ++i)
+    {
+        ASSERT_EQ(expected[i], std::as_const(ints)[i]);
+        ASSERT_EQ(expected[i], std::as_const(doubles)[i]);
+        ASSERT_EQ(expected[i], std::as_const(shorts)[i]);
+    }
+    EXPECT_EQ(1000u, copy.size());
+}
+
+TEST(filter, compact_by_mask)
+{
+    vector<uint64_t> v;
+    for (uint64_t i = 0; i != 200; ++i)
+        v.push_back(i);
+    vector<uint64_t> keep;
+    for (size_t w = 0; w != 4; ++w)
+        keep.push_back(0x5555555555555555ull);
+    EXPECT_EQ(100u, compact(v, keep));
+    ASSERT_EQ(100u, v.size());
+    for (uint64_t i = 0; i != 100; ++i)
+        ASSERT_EQ(2 * i, std::as_const(v)[i]);
+    keep.pop_back();
+    keep.pop_back();
+    EXPECT_THROW(compact(v, vector<uint64_t>()), std::runtime_error);
+    EXPECT_EQ(50u, compact(v, keep));
+}
+
+TEST(filter, erase_if_counted)
+{
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        container c;
+        for (int i = 0; i != 10; ++i)
+            c.push_back(i);
+        container copy = c;
+        EXPECT_EQ(5u, erase_if(c, [](counted const& x) { return x % 2 == 1; }));
+        EXPECT_EQ(5u, c.size());
+        EXPECT_EQ(8, std::as_const(c)[4]);
+        EXPECT_EQ(10u, copy.size());
+    });
+}
+
+TEST(bits, rank_select)
+{
+    bit_vector b;
+    std::vector<size_t> ones;
+    for (size_t i = 0; i != 5000; ++i)
+    {
+        bool bit = (i * 7919) % 5 == 0 || (i > 1000 && i < 1700);
+        b.push_back(bit);
+        if (bit)
+            ones.push_back(i);
+    }
+    EXPECT_EQ(ones.size(), b.count());
+    for (size_t k = 0; k != ones.size(); ++k)
+    {
+        ASSERT_EQ(ones[k], b.select(k));
+        ASSERT_EQ(k, b.rank(ones[k]));
+        ASSERT_EQ(k + 1, b.rank(ones[k] + 1));
+    }
+    EXPECT_EQ(b.size(), b.select(ones.size()));
+    EXPECT_EQ(ones.size(), b.rank(b.size()));
+    b.flip(ones[0]);
+    EXPECT_EQ(ones[1], b.select(0));
+    EXPECT_EQ(ones.size() - 1, b.count());
+}
+
+TEST(bits, bulk_ops)
+{
+    bit_vector a(1000);
+    bit_vector b(1000, true);
+    EXPECT_EQ(1000u, b.count());
+    for (size_t i = 0; i < 1000; i += 3)
+        a.set(i);
+    bit_vector copy = a;
+    a |= b;
+    EXPECT_EQ(1000u, a.count());
+    EXPECT_EQ(334u, copy.count());
+    a.and_not(copy);
+    EXPECT_EQ(666u, a.count());
+    EXPECT_FALSE(a[0]);
+    EXPECT_TRUE(a[1]);
+    a ^= b;
+    EXPECT_TRUE(a == copy);
+    a &= a;
+    EXPECT_TRUE(a == copy);
+    EXPECT_THROW(a &= bit_vector(999), std::runtime_error);
+}
+
+TEST(bits, copy_shares_words)
+{
+    bit_vector a(4096, true);
+    bit_vector b = a;
+    EXPECT_TRUE(a.words().is_shared());
+    b.reset(5);
+    EXPECT_FALSE(a.words().is_shared());
+    EXPECT_TRUE(a[5]);
+    EXPECT_FALSE(b[5]);
+    EXPECT_EQ(4095u, b.rank(4096));
+}
+
+TEST(parallel, for_each_and_transform)
+{
+    vector<int> v;
+    for (int i = 0; i != 100000; ++i)
+        v.push_back(i);
+    vector<int> copy = v;
+    parallel_for_each(v, [](int& x) { x *= 2; });
+    EXPECT_EQ(99999, copy[99999]);
+    EXPECT_EQ(199998, std::as_const(v)[99999]);
+    vector<double> halves;
+    parallel_transform(v, halves, [](int x) { return x / 4.0; }, 1000);
+    ASSERT_EQ(v.size(), halves.size());
+    for (size_t i = 0; i != halves.size(); ++i)
+        ASSERT_EQ(i / 2.0, std::as_const(halves)[i]);
+    parallel_transform(v, v, [](int x) { return x + 1; });
+    EXPECT_EQ(1, std::as_const(v)[0]);
+    EXPECT_EQ(199999, std::as_const(v)[99999]);
+}
+
+static size_t element_copies;
+
+struct copy_counted
+{
+    int value;
+
+    copy_counted(int value = 0) : value(value) {}
+
+    copy_counted(copy_counted const& other) : value(other.value)
+    {
+        ++element_copies;
+    }
+
+    copy_counted& operator=(copy_counted const&) = default;
+};
+
+TEST(parallel, transform_does_not_copy_source)
+{
+    vector<copy_counted> src;
+    for (int i = 0; i != 1000; ++i)
+        src.push_back(i);
+    vector<int> dst;
+    element_copies = 0;
+    parallel_transform(src, dst, [](copy_counted const& x) { return x.value * 2; }, 100);
+    EXPECT_EQ(0u, element_copies);
+    EXPECT_EQ(1998, std::as_const(dst)[999]);
+    EXPECT_EQ(1u, src.use_count());
+}
+
+TEST(parallel, reduce_is_deterministic)
+{
+    vector<double> v;
+    for (int i = 0; i != 200000; ++i)
+        v.push_back(1.0 / (i + 1));
+    auto plus = [](double a, double b) { return a + b; };
+    double first = parallel_reduce(v, 0.0, plus, 512);
+    for (int run = 0; run != 5; ++run)
+        EXPECT_EQ(first, parallel_reduce(v, 0.0, plus, 512));
+    EXPECT_NEAR(12.78, parallel_reduce(v, 0.0, plus), 0.01);
+    vector<long long> ints;
+    for (int i = 1; i <= 100000; ++i)
+        ints.push_back(i);
+    EXPECT_EQ(5000050000ll, parallel_reduce(ints, 0ll, [](long long a, long long b) { return a + b; }));
+    EXPECT_EQ(7, parallel_reduce(vector<int>(), 7, plus));
+}
+
+TEST(parallel, nested_and_throwing)
+{
+    vector<vector<int>> rows;
+    for (int r = 0; r != 64; ++r)
+    {
+        vector<int> row;
+        for (int i = 0; i != 1000; ++i)
+            row.push_back(i);
+        rows.push_back(row);
+    }
+    parallel_for_each(rows, [](vector<int>& row)
+    {
+        parallel_for_each(row, [](int& x) { x += 1; }, 100);
+    }, 1);
+    for (size_t r = 0; r != rows.size(); ++r)
+        ASSERT_EQ(1000, std::as_const(rows)[r][999]);
+    EXPECT_THROW(parallel_for_each(rows[0], [](int x)
+    {
+        if (x == 500)
+            throw std::runtime_error("bad element");
+    }, 10), std::runtime_error);
+}
+
+TEST(fill, value_constructor)
+{
+    vector<double> zeros(100000, 0.0);
+    vector<double> pi(100001, 3.25);
+    vector<int> ints(5, 7);
+    vector<int> one(1, 2);
+    EXPECT_EQ(100000u, zeros.size());
+    EXPECT_EQ(100001u, pi.size());
+    EXPECT_EQ(0.0, std::as_const(zeros)[99999]);
+    EXPECT_TRUE(std::all_of(std::as_const(pi).begin(), std::as_const(pi).end(),
+                            [](double x) { return x == 3.25; }));
+    EXPECT_EQ(5u, ints.size());
+    EXPECT_EQ(7, ints[4]);
+    EXPECT_EQ(2, one[0]);
+    faulty_run([]
+    {
+        counted::no_new_instances_guard g;
+        container c(10, 42);
+        EXPECT_EQ(10u, c.size());
+        EXPECT_EQ(42, c[9]);
+    });
+}
+
+TEST(fill, large_fill_and_iota)
+{
+    struct pair16
+    {
+        double a;
+        double b;
+    };
+    size_t n = (size_t(3) << 20) / sizeof(pair16) + 3;
+    vector<pair16> big(n, pair16{1.5, -2.5});
+    pair16 const* p = std::as_const(big).data();
+    for (size_t i = 0; i != n; ++i)
+    {
+        ASSERT_EQ(1.5, p[i].a);
+        ASSERT_EQ(-2.5, p[i].b);
+    }
+    vector<uint16_t> small(1000, 0);
+    vector<uint16_t> copy = small;
+    small.fill(0x1234);
+    EXPECT_EQ(0x1234, std::as_const(small)[999]);
+    EXPECT_EQ(0, copy[999]);
+    copy.iota(10);
+    EXPECT_EQ(10, copy[0]);
+    EXPECT_EQ(1009, copy[999]);
+    EXPECT_EQ(0x1234, std::as_const(small)[0]);
+}
+
+TEST(compressed, frame_of_reference_round_trip)
+{
+    vector<uint32_t> v;
+    for (uint32_t i = 0; i != 1000; ++i)
+        v.push_back(1000000 + (i * 7919) % 5000);
+    v.push_back(0xffffffffu);
+    compressed_vector<uint32_t> c(v);
+    EXPECT_EQ(v.size(), c.size());
+    EXPECT_LT(c.compressed_bytes(), v.size() * sizeof(uint32_t) / 2);
+    for (size_t i = 0; i != v.size(); ++i)
+        ASSERT_EQ(std::as_const(v)[i], c[i]);
+    vector<uint32_t> out;
+    c.decompress(out);
+    EXPECT_TRUE(out == v);
+    uint32_t const* buffer = std::as_const(out).data();
+    c.decompress(out);
+    EXPECT_EQ(buffer, std::as_const(out).data());
+}
+
+// a block must not reallocate the packed words to the exact size, that copies everything
+// packed so far and makes building quadratic
+TEST(compressed, build_scales_linearly)
+{
+    auto build_seconds = [](size_t n) {
+        vector<uint32_t> v;
+        for (size_t i = 0; i != n; ++i)
+            v.push_back(static_cast<uint32_t>(i * 2654435761u));
+        double best = 1e9;
+        for (int run = 0; run != 3; ++run)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            compressed_vector<uint32_t> c(v);
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            EXPECT_EQ(n, c.size());
+        }
+        return best;
+    };
+    double small = build_seconds(size_t(1) << 14);
+    double large = build_seconds(size_t(1) << 19);
+    EXPECT_LT(large, 96 * small);
+}
+
+TEST(compressed, delta_append)
+{
+    compressed_vector<uint64_t, compression::delta> c;
+    vector<uint64_t> expected;
+    uint64_t t = 1560000000000ull;
+    for (size_t i = 0; i != 1000; ++i)
+    {
+        t += (i * 31) % 17;
+        c.push_back(t);
+        expected.push_back(t);
+    }
+    c.push_back(0);
+    expected.push_back(0);
+    EXPECT_EQ(expected.size(), c.size());
+    EXPECT_LT(c.compressed_bytes(), expected.size() * sizeof(uint64_t) / 4);
+    EXPECT_EQ(expected[500], c[500]);
+    EXPECT_EQ(0u, c[1000]);
+    compressed_vector<uint64_t, compression::delta> copy = c;
+    copy.push_back(7);
+    EXPECT_EQ(1001u, c.size());
+    EXPECT_TRUE(c.decompress() == expected);
+    EXPECT_EQ(7u, copy[1001]);
+}
+
+TEST(serialization, stream_round_trip)
+{
+    vector<double> v;
+    for (int i = 0; i != 1000; ++i)
+        v.push_back(i * 0.5);
+    std::stringstream ss;
+    serialize(v, ss, true);
+    EXPECT_EQ(vector_format::DATA_OFFSET + 1000 * sizeof(double), ss.str().size());
+    vector<double> back = deserialize<double>(ss);
+    EXPECT_TRUE(back == v);
+
+    std::string bytes = ss.str();
+    bytes[vector_format::DATA_OFFSET + 5] ^= 1;
+    std::stringstream corrupted(bytes);
+    EXPECT_THROW(deserialize<double>(corrupted), std::runtime_error);
+    std::stringstream wrong_type(ss.str());
+    EXPECT_THROW(deserialize<float>(wrong_type), std::runtime_error);
+}
+
+TEST(serialization, fd_round_trip)
+{
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(nullptr, file);
+    int fd = fileno(file);
+    vector<uint32_t> v;
+    for (uint32_t i = 0; i != 100000; ++i)
+        v.push_back(i * 2654435761u);
+    vector<uint32_t> one;
+    one.push_back(7);
+    serialize(v, fd);
+    serialize(one, fd, true);
+    serialize(vector<uint32_t>(), fd);
+    ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+    EXPECT_TRUE(deserialize<uint32_t>(fd) == v);
+    EXPECT_TRUE(deserialize<uint32_t>(fd) == one);
+    EXPECT_EQ(0u, deserialize<uint32_t>(fd).size());
+    EXPECT_THROW(deserialize<uint32_t>(fd), std::runtime_error);
+    std::fclose(file);
+}
+
+TEST(serialization, corrupted_count)
+{
+    vector<uint64_t> v;
+    for (uint64_t i = 0; i != 100; ++i)
+        v.push_back(i);
+    std::stringstream ss;
+    serialize(v, ss);
+    std::string bytes = ss.str();
+    vector_format::file_header h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    for (uint64_t count : {uint64_t(1) << 61, uint64_t(1) << 40, uint64_t(101)}) {
+        h.count = count;
+        std::memcpy(&bytes[0], &h, sizeof(h));
+        std::stringstream in(bytes);
+        EXPECT_THROW(deserialize<uint64_t>(in), std::runtime_error);
+
+        std::FILE* file = std::tmpfile();
+        ASSERT_NE(nullptr, file);
+        int fd = fileno(file);
+        ASSERT_EQ(static_cast<ssize_t>(bytes.size()), write(fd, bytes.data(), bytes.size()));
+        ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+        EXPECT_THROW(deserialize<uint64_t>(fd), std::runtime_error);
+        std::fclose(file);
+
+        int pipe_fds[2];
+        ASSERT_EQ(0, pipe(pipe_fds));
+        ASSERT_EQ(static_cast<ssize_t>(bytes.size()), write(pipe_fds[1], bytes.data(), bytes.size()));
+        close(pipe_fds[1]);
+        EXPECT_THROW(deserialize<uint64_t>(pipe_fds[0]), std::runtime_error);
+        close(pipe_fds[0]);
+    }
+
+    int pipe_fds[2];
+    ASSERT_EQ(0, pipe(pipe_fds));
+    ASSERT_EQ(static_cast<ssize_t>(ss.str().size()), write(pipe_fds[1], ss.str().data(), ss.str().size()));
+    close(pipe_fds[1]);
+    EXPECT_TRUE(deserialize<uint64_t>(pipe_fds[0]) == v);
+    close(pipe_fds[0]);
+}
+
+static size_t mappings_of(std::string const& path)
+{
+    std::ifstream maps("/proc/self/maps");
+    size_t result = 0;
+    for (std::string line; std::getline(maps, line);)
+        result += line.find(path) != std::string::npos;
+    return result;
+}
+
+TEST(mapped, read_then_detach)
+{
+    std::string path = "/tmp/super_vector_mapped_" + std::to_string(getpid());
+    vector<uint64_t> v;
+    for (uint64_t i = 0; i != 10000; ++i)
+        v.push_back(i * i);
+    {
+        int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        ASSERT_LE(0, fd);
+        serialize(v, fd);
+        ::close(fd);
+    }
+    {
+        vector<uint64_t> m = map_file<uint64_t>(path.c_str());
+        EXPECT_TRUE(m.is_mapped());
+        EXPECT_EQ(1u, m.use_count());
+        EXPECT_TRUE(m == v);
+        EXPECT_EQ(1u, mappings_of(path));
+        vector<uint64_t> copy = m;
+        EXPECT_EQ(2u, m.use_count());
+        copy[5] = 1;
+        EXPECT_FALSE(copy.is_mapped());
+        EXPECT_EQ(25u, std::as_const(m)[5]);
+        m.push_back(7);
+        EXPECT_FALSE(m.is_mapped());
+        EXPECT_EQ(0u, mappings_of(path));
+    }
+    EXPECT_TRUE(deserialize<uint64_t>(*std::make_unique<std::ifstream>(path)) == v);
+    {
+        vector<uint64_t> m = map_file<uint64_t>(path.c_str());
+        EXPECT_EQ(1u, mappings_of(path));
+    }
+    EXPECT_EQ(0u, mappings_of(path));
+    ::unlink(path.c_str());
+}
+
+TEST(mapped, rejects_foreign_files)
+{
+    EXPECT_THROW(map_file<int>("/nonexistent/super_vector"), std::system_error);
+    std::string path = "/tmp/super_vector_mapped_bad_" + std::to_string(getpid());
+    {
+        std::ofstream out(path);
+        serialize(vector<int>(300, 1), out);
+    }
+    EXPECT_THROW(map_file<double>(path.c_str()), std::runtime_error);
+    EXPECT_EQ(300u, map_file<int>(path.c_str()).size());
+    ::truncate(path.c_str(), 1000);
+    EXPECT_THROW(map_file<int>(path.c_str()), std::runtime_error);
+
+    vector_format::file_header h = vector_format::make_header(sizeof(int), 1);
+    for (uint64_t data_offset : {uint64_t(1) << 20, uint64_t(320), uint64_t(257)}) {
+        h.data_offset = data_offset;
+        {
+            std::ofstream out(path, std::ios::trunc);
+            out.write(reinterpret_cast<char const*>(&h), sizeof(h));
+            out.write("\0\0\0\0", 4);
+        }
+        EXPECT_THROW(map_file<int>(path.c_str()), std::runtime_error);
+    }
+    ::unlink(path.c_str());
+}
+
+TEST(persistent, survives_reopen)
+{
+    std::string path = "/tmp/super_vector_persistent_" + std::to_string(getpid());
+    ::unlink(path.c_str());
+    {
+        persistent_vector<uint64_t> p(path.c_str());
+        EXPECT_TRUE(p.empty());
+        for (uint64_t i = 0; i != 100000; ++i)
+            p.push_back(i * 3);
+        p.pop_back();
+        p.flush();
+    }
+    {
+        persistent_vector<uint64_t> p(path.c_str());
+        ASSERT_EQ(99999u, p.size());
+        EXPECT_EQ(3 * 99998u, p.back());
+        p[0] = 42;
+        p.push_back(5);
+        persistent_vector<uint64_t> moved = std::move(p);
+        EXPECT_EQ(100000u, moved.size());
+    }
+    vector<uint64_t> mapped = map_file<uint64_t>(path.c_str());
+    EXPECT_EQ(100000u, mapped.size());
+    EXPECT_EQ(42u, mapped[0]);
+    EXPECT_EQ(5u, std::as_const(mapped)[99999]);
+    std::ifstream in(path);
+    EXPECT_TRUE(deserialize<uint64_t>(in) == mapped);
+    EXPECT_THROW(persistent_vector<uint32_t>(path.c_str()), std::runtime_error);
+    ::unlink(path.c_str());
+}
+
+TEST(persistent, reserve_and_shrink)
+{
+    std::string path = "/tmp/super_vector_persistent_shrink_" + std::to_string(getpid());
+    ::unlink(path.c_str());
+    persistent_vector<int> p(path.c_str());
+    p.reserve(1000);
+    EXPECT_LE(1000u, p.capacity());
+    for (int i = 0; i != 10; ++i)
+        p.push_back(i);
+    p.shrink_to_fit();
+    EXPECT_EQ(10u, p.capacity());
+    struct stat st;
+    ASSERT_EQ(0, ::stat(path.c_str(), &st));
+    EXPECT_EQ(vector_format::DATA_OFFSET + 10 * sizeof(int), static_cast<size_t>(st.st_size));
+    p.push_back(10);
+    EXPECT_LE(11u, p.capacity());
+    EXPECT_EQ(10, p[10]);
+    p.clear();
+    EXPECT_TRUE(p.empty());
+    ::unlink(path.c_str());
+}
+
+static std::vector<std::pair<char*, size_t>> synced;
+
+TEST(persistent, flush_syncs_header_page_last)
+{
+    std::string path = "/tmp/super_vector_persistent_flush_" + std::to_string(getpid());
+    ::unlink(path.c_str());
+    persistent_vector<uint64_t> p(path.c_str());
+    char* base = reinterpret_cast<char*>(p.data()) - vector_format::DATA_OFFSET;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    persistent_detail::msync = [](void* addr, size_t length, int flags) {
+        synced.emplace_back(static_cast<char*>(addr), length);
+        return ::msync(addr, length, flags);
+    };
+
+    for (uint64_t i = 0; i != 10; ++i)
+        p.push_back(i);
+    synced.clear();
+    p.flush();
+    ASSERT_EQ(1u, synced.size());
+    EXPECT_EQ(base, synced[0].first);
+    EXPECT_EQ(vector_format::DATA_OFFSET + 10 * sizeof(uint64_t), synced[0].second);
+
+    for (uint64_t i = 10; i != 100000; ++i)
+        p.push_back(i);
+    base = reinterpret_cast<char*>(p.data()) - vector_format::DATA_OFFSET;
+    synced.clear();
+    p.flush();
+    persistent_detail::msync = ::msync;
+    ASSERT_EQ(2u, synced.size());
+    EXPECT_EQ(base + page, synced[0].first);
+    EXPECT_EQ(vector_format::DATA_OFFSET + 100000 * sizeof(uint64_t) - page, synced[0].second);
+    EXPECT_EQ(base, synced[1].first);
+    EXPECT_EQ(page, synced[1].second);
+    ::unlink(path.c_str());
+}
+
+TEST(shm, attach_in_child_process)
+{
+    vector<uint32_t> v;
+    for (uint32_t i = 0; i != 100000; ++i)
+        v.push_back(i * 7);
+    shm_vector<uint32_t> shared = shm_vector<uint32_t>::create(v);
+    EXPECT_EQ(1u, shared.use_count());
+    pid_t child = fork();
+    ASSERT_LE(0, child);
+    if (child == 0)
+    {
+        int code;
+        {
+            shm_vector<uint32_t> view = shm_vector<uint32_t>::attach(shared.fd());
+            code = view.size() == 100000 && view[99999] == 99999 * 7 && view.use_count() == 2
+                && view.data() != shared.data() ? 0 : 1;
+        }
+        _exit(code);
+    }
+    int status = 0;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+    EXPECT_EQ(1u, shared.use_count());
+    EXPECT_TRUE(shared.to_vector() == v);
+}
+
+TEST(shm, named_region)
+{
+    std::string name = "/super_vector_shm_" + std::to_string(getpid());
+    {
+        shm_vector<double> owner = shm_vector<double>::create(vector<double>(1000, 2.5), name.c_str());
+        EXPECT_THROW(shm_vector<double>::create(vector<double>(), name.c_str()), std::system_error);
+        EXPECT_THROW(shm_vector<int32_t>::attach(name.c_str()), std::runtime_error);
+        shm_vector<double> second = shm_vector<double>::attach(name.c_str());
+        EXPECT_EQ(2u, owner.use_count());
+        EXPECT_EQ(2.5, second[999]);
+        shm_vector<double> moved = std::move(second);
+        EXPECT_EQ(2u, moved.use_count());
+    }
+    EXPECT_THROW(shm_vector<double>::attach(name.c_str()), std::system_error);
+}
+
+TEST(shm, rejects_forged_header)
+{
+    std::string name = "/super_vector_shm_forged_" + std::to_string(getpid());
+    shm_vector<double> owner = shm_vector<double>::create(vector<double>(1000, 2.5), name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_LE(0, fd);
+    // data_offset follows magic, element_size and count
+    uint64_t data_offset = uint64_t(1) << 40;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(data_offset)), pwrite(fd, &data_offset, sizeof(data_offset), 24));
+    close(fd);
+    EXPECT_THROW(shm_vector<double>::attach(name.c_str()), std::runtime_error);
+    EXPECT_EQ(1u, owner.use_count());
+}
+
+TEST(arrow, export_without_copy)
+{
+    vector<int32_t> v;
+    for (int32_t i = 0; i != 1000; ++i)
+        v.push_back(i - 500);
+    int32_t const* original = std::as_const(v).data();
+    ArrowArray array;
+    ArrowSchema schema;
+    to_arrow(v, &array, &schema);
+    EXPECT_EQ(2u, v.use_count());
+    // what a consumer sees
+    EXPECT_STREQ("i", schema.format);
+    EXPECT_EQ(1000, array.length);
+    EXPECT_EQ(0, array.null_count);
+    EXPECT_EQ(2, array.n_buffers);
+    EXPECT_EQ(nullptr, array.buffers[0]);
+    EXPECT_EQ(original, array.buffers[1]);
+    v[0] = 42;
+    v.push_back(7);
+    auto const* column = static_cast<int32_t const*>(array.buffers[1]);
+    EXPECT_EQ(-500, column[0]);
+    EXPECT_EQ(499, column[999]);
+    array.release(&array);
+    schema.release(&schema);
+    EXPECT_EQ(nullptr, array.release);
+    EXPECT_EQ(nullptr, schema.release);
+    EXPECT_EQ(1u, v.use_count());
+}
+
+TEST(arrow, import_round_trip)
+{
+    vector<double> v(300, 1.5);
+    vector<double> small;
+    small.push_back(3.0);
+    ArrowArray array;
+    ArrowSchema schema;
+    to_arrow(v, &array, &schema);
+    EXPECT_THROW(from_arrow<float>(&array, &schema), std::runtime_error);
+    ASSERT_NE(nullptr, array.release);
+    {
+        arrow_view<double> view = from_arrow<double>(&array, &schema);
+        EXPECT_EQ(nullptr, array.release);
+        EXPECT_EQ(300u, view.size());
+        EXPECT_EQ(std::as_const(v).data(), view.data());
+        arrow_view<double> moved = std::move(view);
+        EXPECT_EQ(2u, v.use_count());
+        EXPECT_TRUE(moved.to_vector() == v);
+    }
+    EXPECT_EQ(1u, v.use_count());
+    schema.release(&schema);
+
+    to_arrow(small, &array, &schema);
+    arrow_view<double> view = from_arrow<double>(&array, &schema);
+    ASSERT_EQ(1u, view.size());
+    EXPECT_EQ(3.0, view[0]);
+    small[0] = 4.0;
+    EXPECT_EQ(3.0, view[0]);
+    schema.release(&schema);
+}
+
+TEST(arrow, import_offset_slice)
+{
+    int64_t buffer[] = {1, 2, 3, 4, 5};
+    const void* buffers[] = {nullptr, buffer};
+    ArrowSchema schema = {"l", "", nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr};
+    static int released;
+    released = 0;
+    ArrowArray array = {3, 0, 2, 2, 0, buffers, nullptr, nullptr,
+                        [](ArrowArray* a) { ++released; a->release = nullptr; }, nullptr};
+    for (int64_t null_count : {int64_t(-1), int64_t(1)}) {
+        array.null_count = null_count;
+        EXPECT_THROW(from_arrow<int64_t>(&array, &schema), std::runtime_error);
+        ASSERT_NE(nullptr, array.release);
+    }
+    array.null_count = 0;
+    {
+        arrow_view<int64_t> view = from_arrow<int64_t>(&array, &schema);
+        EXPECT_EQ(3u, view.size());
+        EXPECT_EQ(3, view[0]);
+        EXPECT_EQ(5, view[2]);
+        EXPECT_EQ(3, view.end() - view.begin());
+    }
+    EXPECT_EQ(1, released);
+}
+
+TEST(checkpoint, writer_detaches_from_snapshot)
+{
+    std::string path = "/tmp/super_vector_checkpoint_" + std::to_string(getpid());
+    vector<uint64_t> v;
+    for (uint64_t i = 0; i != (1u << 18); ++i)
+        v.push_back(i);
+    vector<uint64_t> frozen = v.snapshot();
+    EXPECT_EQ(2u, v.use_count());
+    EXPECT_EQ(std::as_const(v).data(), std::as_const(frozen).data());
+    {
+        checkpoint<vector<uint64_t>> cp(v, path);
+        for (uint64_t i = 0; i < v.size(); i += 1000)
+            v[i] = 0;
+        v.push_back(1);
+        EXPECT_EQ(1u, v.use_count());
+        cp.wait();
+        EXPECT_TRUE(cp.done());
+        EXPECT_EQ(1u, frozen.use_count());
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    ASSERT_LE(0, fd);
+    EXPECT_TRUE(deserialize<uint64_t>(fd) == frozen);
+    ::close(fd);
+    std::remove(path.c_str());
+}
+
+TEST(checkpoint, paged_vector_per_page_detach)
+{
+    std::string path = "/tmp/super_vector_checkpoint_paged_" + std::to_string(getpid());
+    paged_vector<uint32_t, 256> v;
+    vector<uint32_t> expected;
+    for (uint32_t i = 0; i != 10000; ++i)
+    {
+        v.push_back(i * 3);
+        expected.push_back(i * 3);
+    }
+    checkpoint<paged_vector<uint32_t, 256>> cp(v, path);
+    v[5] = 1;
+    EXPECT_FALSE(v.is_page_shared(0) && v.is_page_shared(1));
+    v.pop_back();
+    cp.wait();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    ASSERT_LE(0, fd);
+    EXPECT_TRUE(deserialize<uint32_t>(fd) == expected);
+    ::close(fd);
+    std::remove(path.c_str());
+}
+
+TEST(checkpoint, error_surfaces_in_wait)
+{
+    vector<int> v(100, 1);
+    checkpoint<vector<int>> cp(v, "/nonexistent_dir/checkpoint");
+    EXPECT_THROW(cp.wait(), std::system_error);
+    EXPECT_TRUE(cp.done());
+    EXPECT_EQ(1u, v.use_count());
+}